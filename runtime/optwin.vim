@@ -1163,6 +1163,8 @@ call <SID>OptionG("dir", &dir)
 call <SID>AddOption("swapfile", gettext("use a swap file for this buffer"))
 call append("$", "\t" .. s:local_to_buffer)
 call <SID>BinOptionL("swf")
+call <SID>AddOption("swapjournal", gettext("append changes to a journal instead of writing the swap file"))
+call <SID>BinOptionG("swj", &swj)
 call <SID>AddOption("swapsync", gettext("\"sync\", \"fsync\" or empty; how to flush a swap file to disk"))
 call <SID>OptionG("sws", &sws)
 call <SID>AddOption("updatecount", gettext("number of characters typed to cause a swap file update"))
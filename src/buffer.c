@@ -41,6 +41,8 @@ static char_u	*fname_match(regmatch_T *rmp, char_u *name, int ignore_case);
 static buf_T	*buflist_findname_stat(char_u *ffname, stat_T *st);
 static int	otherfile_buf(buf_T *buf, char_u *ffname, stat_T *stp);
 static int	buf_same_ino(buf_T *buf, stat_T *stp);
+static int	buf_index_build(void);
+static void	buf_index_add(buf_T *buf);
 #else
 static int	otherfile_buf(buf_T *buf, char_u *ffname);
 #endif
@@ -495,6 +497,98 @@ buf_hashtab_remove(buf_T *buf)
 	hash_remove(&buf_hashtab, hi, "close buffer");
 }
 
+#ifdef UNIX
+/*
+ * Index to quickly find a buffer by its full file name or by its device and
+ * inode number, used by buflist_findname_stat().  Going through the whole
+ * buffer list for every new buffer is too slow when starting with thousands
+ * of file arguments.
+ * A new buffer is added to the index.  When the name or inode of a buffer
+ * changes, or a buffer is freed, the index is made invalid and built again
+ * when it is used.  A buffer may also be found under its old name or inode,
+ * buflist_findname_stat() checks for that.
+ */
+static buf_T	**buf_index_name = NULL;    // buckets for the file name
+static buf_T	**buf_index_ino = NULL;	    // buckets for the dev and inode
+static long_u	buf_index_mask = 0;	    // number of buckets minus one
+static long_u	buf_index_count = 0;	    // number of buffers in the index
+static int	buf_index_valid = FALSE;
+
+# define BUF_INDEX_INO(dev, ino) \
+	(((long_u)(ino) * 31 + (long_u)(dev)) & buf_index_mask)
+
+/*
+ * Build the buffer index from the buffer list.
+ * Returns FAIL when out of memory.
+ */
+    static int
+buf_index_build(void)
+{
+    buf_T	*buf;
+    long_u	size = 64;
+
+    buf_index_count = 0;
+    FOR_ALL_BUFFERS(buf)
+	++buf_index_count;
+    while (size < buf_index_count * 4)
+	size *= 2;
+
+    buf_index_name = ALLOC_CLEAR_MULT(buf_T *, size);
+    buf_index_ino = ALLOC_CLEAR_MULT(buf_T *, size);
+    if (buf_index_name == NULL || buf_index_ino == NULL)
+    {
+	VIM_CLEAR(buf_index_name);
+	VIM_CLEAR(buf_index_ino);
+	return FAIL;
+    }
+    buf_index_mask = size - 1;
+
+    FOR_ALL_BUFFERS(buf)
+	buf_index_add(buf);
+    buf_index_valid = TRUE;
+    return OK;
+}
+
+/*
+ * Add buffer "buf" to the buffer index.
+ */
+    static void
+buf_index_add(buf_T *buf)
+{
+    long_u	idx;
+
+    if (buf->b_ffname != NULL)
+    {
+	idx = hash_hash(buf->b_ffname) & buf_index_mask;
+	buf->b_index_name_next = buf_index_name[idx];
+	buf_index_name[idx] = buf;
+    }
+    if (buf->b_dev_valid)
+    {
+	idx = BUF_INDEX_INO(buf->b_dev, buf->b_ino);
+	buf->b_index_ino_next = buf_index_ino[idx];
+	buf_index_ino[idx] = buf;
+    }
+}
+#endif
+
+/*
+ * Must be called when the name or inode of a buffer was changed and when a
+ * buffer is freed.
+ */
+    void
+buf_index_invalidate(void)
+{
+#ifdef UNIX
+    if (buf_index_valid)
+    {
+	VIM_CLEAR(buf_index_name);
+	VIM_CLEAR(buf_index_ino);
+	buf_index_valid = FALSE;
+    }
+#endif
+}
+
 /*
  * Return TRUE when buffer "buf" can be unloaded.
  * Give an error message and return FALSE when the buffer is locked or the
@@ -960,6 +1054,9 @@ buf_freeall(buf_T *buf, int flags)
 	u_clearallandblockfree(buf);
 #ifdef FEAT_SYN_HL
     syntax_clear(&buf->b_s);	    // reset syntax info
+# ifdef FEAT_PERSISTENT_UNDO
+    syn_stack_free_cache(&buf->b_s);
+# endif
 #endif
 #ifdef FEAT_PROP_POPUP
     clear_buf_prop_types(buf);
@@ -1013,6 +1110,7 @@ free_buffer(buf_T *buf)
 #endif
 
     buf_hashtab_remove(buf);
+    buf_index_invalidate();
 
     aubuflocal_remove(buf);
 
@@ -2382,6 +2480,15 @@ buflist_new(
     buf->b_flags = BF_CHECK_RO | BF_NEVERLOADED;
     if (flags & BLN_DUMMY)
 	buf->b_flags |= BF_DUMMY;
+#ifdef UNIX
+    if (buf == curbuf || buf_index_count * 2 >= buf_index_mask)
+	buf_index_invalidate();
+    else if (buf_index_valid)
+    {
+	++buf_index_count;
+	buf_index_add(buf);
+    }
+#endif
     buf_clear_file(buf);
     clrallmarks(buf);			// clear marks
     fmarks_check_names(buf);		// check file marks for this file
@@ -2709,6 +2816,30 @@ buflist_findname_stat(
 {
 #endif
     buf_T	*buf;
+#ifdef UNIX
+    buf_T	*found = NULL;
+
+    // The index can't be used when ignoring case.
+    if (!p_fic && (buf_index_valid || buf_index_build() == OK))
+    {
+	// When there are several matches use the last one in the list, it
+	// has the highest number.
+	for (buf = buf_index_name[hash_hash(ffname) & buf_index_mask];
+					buf != NULL; buf = buf->b_index_name_next)
+	    if ((buf->b_flags & BF_DUMMY) == 0 && buf->b_ffname != NULL
+		    && (found == NULL || buf->b_fnum > found->b_fnum)
+		    && fnamecmp(ffname, buf->b_ffname) == 0)
+		found = buf;
+	if (stp->st_dev != (dev_T)-1)
+	    for (buf = buf_index_ino[BUF_INDEX_INO(stp->st_dev, stp->st_ino)];
+					 buf != NULL; buf = buf->b_index_ino_next)
+		if ((buf->b_flags & BF_DUMMY) == 0
+			&& (found == NULL || buf->b_fnum > found->b_fnum)
+			&& !otherfile_buf(buf, ffname, stp))
+		    found = buf;
+	return found;
+    }
+#endif
 
     // Start at the last buffer, expect to find a match sooner.
     FOR_ALL_BUFS_FROM_LAST(buf)
@@ -3681,6 +3812,7 @@ buf_set_name(int fnum, char_u *name)
     // files on Win32.
     fname_expand(buf, &buf->b_ffname, &buf->b_sfname);
     buf->b_fname = buf->b_sfname;
+    buf_index_invalidate();
 }
 
 /*
@@ -3690,6 +3822,8 @@ buf_set_name(int fnum, char_u *name)
     void
 buf_name_changed(buf_T *buf)
 {
+    buf_index_invalidate();
+
     /*
      * If the file name changed, also change the name of the swapfile
      */
@@ -3867,6 +4001,8 @@ buf_setino(buf_T *buf)
 
     if (buf->b_fname != NULL && mch_stat((char *)buf->b_fname, &st) >= 0)
     {
+	if (!buf_same_ino(buf, &st))
+	    buf_index_invalidate();
 	buf->b_dev_valid = TRUE;
 	buf->b_dev = st.st_dev;
 	buf->b_ino = st.st_ino;
@@ -22,6 +22,7 @@
 #endif
 
 #define SMALLBUFSIZE	256	// size of emergency write buffer
+#define BIGBUFSIZE	65536	// size of write buffer when not encrypting
 
 /*
  * Structure to pass arguments from buf_write() to buf_write_bytes().
@@ -648,9 +649,12 @@ buf_write(
     char_u	    *ffname;
     char_u	    *wfname = NULL;	// name of file to write to
     char_u	    *s;
+    char_u	    *cp;
     char_u	    *ptr;
     char_u	    c;
     int		    len;
+    int		    n;
+    colnr_T	    linelen;
     linenr_T	    lnum;
     long	    nchars;
     char_u	    *errmsg = NULL;
@@ -1030,7 +1034,14 @@ buf_write(
 		    (char_u *)"", 0);	// show that we are busy
     msg_scroll = FALSE;		    // always overwrite the file message now
 
-    buffer = alloc(WRITEBUFSIZE);
+    // Fewer write() calls are faster.  An encrypted file must be written in
+    // blocks of WRITEBUFSIZE bytes, reading decrypts blocks of that size.
+    bufsize = WRITEBUFSIZE;
+#ifdef FEAT_CRYPT
+    if (*buf->b_p_key == NUL)
+#endif
+	bufsize = BIGBUFSIZE;
+    buffer = alloc(bufsize);
     if (buffer == NULL)		    // can't allocate big buffer, use small
 				    // one (to be able to write when out of
 				    // memory)
@@ -1038,8 +1049,6 @@ buf_write(
 	buffer = smallbuf;
 	bufsize = SMALLBUFSIZE;
     }
-    else
-	bufsize = WRITEBUFSIZE;
 
     // Get information about original file (if there is one).
 #if defined(UNIX)
@@ -2049,32 +2058,34 @@ restore_backup:
 	len = 0;
 	for (lnum = start; lnum <= end; ++lnum)
 	{
-	    // The next while loop is done once for each character written.
+	    // The text is copied into the buffer in pieces as big as what fits.
 	    // Keep it fast!
-	    ptr = ml_get_buf(buf, lnum, FALSE) - 1;
+	    ptr = ml_get_buf(buf, lnum, FALSE);
+	    linelen = ml_get_buf_len(buf, lnum);
 #ifdef FEAT_PERSISTENT_UNDO
 	    if (write_undo_file)
-		sha256_update(&sha_ctx, ptr + 1,
-					      (UINT32_T)(STRLEN(ptr + 1) + 1));
+		sha256_update(&sha_ctx, ptr, (UINT32_T)(linelen + 1));
 #endif
-	    while ((c = *++ptr) != NUL)
+	    while (linelen > 0)
 	    {
-		if (c == NL)
-		    *s = NUL;		// replace newlines with NULs
-		else if (c == CAR && fileformat == EOL_MAC)
-		    *s = NL;		// Mac: replace CRs with NLs
-		else
-		    *s = c;
-		++s;
-		if (++len != bufsize)
+		n = bufsize - len;
+		if (n > linelen)
+		    n = linelen;
+		mch_memmove(s, ptr, (size_t)n);
+		// replace newlines with NULs, for Mac replace CRs with NLs
+		for (cp = s; (cp = memchr(cp, NL, (size_t)(s + n - cp)))
+								   != NULL; )
+		    *cp++ = NUL;
+		if (fileformat == EOL_MAC)
+		    for (cp = s; (cp = memchr(cp, CAR, (size_t)(s + n - cp)))
+								   != NULL; )
+			*cp++ = NL;
+		s += n;
+		ptr += n;
+		linelen -= n;
+		len += n;
+		if (len != bufsize)
 		    continue;
-#ifdef FEAT_CRYPT
-		if (write_info.bw_fd > 0 && lnum == end
-			&& (write_info.bw_flags & FIO_ENCRYPTED)
-			&& *buf->b_p_key != NUL && !filtering
-			&& *ptr == NUL)
-		    write_info.bw_finish = TRUE;
- #endif
 		if (buf_write_bytes(&write_info) == FAIL)
 		{
 		    end = 0;		// write error: break loop
@@ -183,6 +183,56 @@ change_other_buffer_restore(cob_T *cob)
     VIsual_active = cob->cob_save_VIsual_active;
 }
 
+/*
+ * Append "line" and the list items from "li" onwards below line "lnum" in
+ * the current buffer, with one call to ml_append_lines().  "*added" is
+ * incremented for the appended lines.
+ * Returns FAIL when an item could not be converted to a string.
+ */
+    static int
+append_list_lines(
+	linenr_T    lnum,
+	char_u	    *line,
+	listitem_T  *li,
+	long	    *added)
+{
+    garray_T	lines;
+    garray_T	tofree;
+    char_u	*p;
+    linenr_T	old_count = curbuf->b_ml.ml_line_count;
+    int		ret = OK;
+
+    ga_init2(&lines, sizeof(char_u *), 100);
+    ga_init2(&tofree, sizeof(char_u *), 10);
+    if (ga_add_string(&lines, line) == FAIL)
+	ret = FAIL;
+    for ( ; li != NULL && ret == OK; li = li->li_next)
+    {
+	// A String can be used without making a copy.
+	if (li->li_tv.v_type == VAR_STRING)
+	    p = li->li_tv.vval.v_string == NULL ? (char_u *)""
+						 : li->li_tv.vval.v_string;
+	else if ((p = typval_tostring(&li->li_tv, FALSE)) == NULL
+					  || ga_add_string(&tofree, p) == FAIL)
+	{
+	    vim_free(p);
+	    ret = FAIL;
+	    break;
+	}
+	if (ga_add_string(&lines, p) == FAIL)
+	    ret = FAIL;
+    }
+
+    if (lines.ga_len == 0 || ml_append_lines(lnum, (char_u **)lines.ga_data,
+						   lines.ga_len, 0) == FAIL)
+	ret = FAIL;
+    *added += curbuf->b_ml.ml_line_count - old_count;
+
+    ga_clear(&lines);
+    ga_clear_strings(&tofree);
+    return ret;
+}
+
 /*
  * Set line or list of lines in buffer "buf" to "lines".
  * Any type is allowed and converted to a string.
@@ -282,6 +332,14 @@ set_buffer_lines(
 	}
 	else if (added > 0 || u_save(lnum - 1, lnum) == OK)
 	{
+	    if (l != NULL)
+	    {
+		// append this line and all the following ones
+		if (append_list_lines(lnum - 1, line, li, &added) == OK)
+		    rettv->vval.v_number = 0;	// OK
+		break;
+	    }
+
 	    // append the line
 	    ++added;
 	    if (ml_append(lnum - 1, line, (colnr_T)0, FALSE) == OK)
@@ -2039,6 +2039,7 @@ rename_buffer(char_u *new_fname)
     {
 	curbuf->b_ffname = fname;
 	curbuf->b_sfname = sfname;
+	buf_index_invalidate();
 	return FAIL;
     }
     curbuf->b_flags |= BF_NOTEDITED;
@@ -4375,6 +4376,10 @@ ex_substitute(exarg_T *eap)
 #endif
 		); ++lnum)
     {
+	// skip over lines that cannot match
+	lnum = vim_regexec_multi_skip(&regmatch, curwin, curbuf, lnum, line2);
+	if (lnum > line2)
+	    break;
 	nmatch = vim_regexec_multi(&regmatch, curwin, curbuf, lnum,
 						       (colnr_T)0, NULL);
 	if (nmatch)
@@ -5454,6 +5459,20 @@ ex_global(exarg_T *eap)
 	 */
 	for (lnum = eap->line1; lnum <= eap->line2 && !got_int; ++lnum)
 	{
+	    linenr_T	lnum_may;
+
+	    // skip over lines that cannot match
+	    lnum_may = vim_regexec_multi_skip(&regmatch, curwin, curbuf, lnum,
+								  eap->line2);
+	    for ( ; lnum < lnum_may; ++lnum)
+		if (type == 'v')
+		{
+		    ml_setmarked(lnum);
+		    ndone++;
+		}
+	    if (lnum > eap->line2)
+		break;
+
 	    // a match on this line?
 	    match = vim_regexec_multi(&regmatch, curwin, curbuf, lnum,
 						       (colnr_T)0, NULL);
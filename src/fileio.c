@@ -40,6 +40,8 @@ static char_u *readfile_charconvert(char_u *fname, char_u *fenc, int *fdp);
 static char_u *check_for_cryptkey(char_u *cryptkey, char_u *ptr, long *sizep, off_T *filesizep, int newfile, char_u *fname, int *did_ask);
 #endif
 static linenr_T readfile_linenr(linenr_T linecnt, char_u *p, char_u *endp);
+static long readfile_skip_text(char_u *p, long len, int mac);
+static long readfile_skip_ascii(char_u *p, long len);
 static char_u *check_for_bom(char_u *p, long size, int *lenp, int flags);
 
 #ifdef FEAT_EVAL
@@ -152,6 +154,7 @@ readfile(
     int		wasempty;		// buffer was empty before reading
     colnr_T	len;
     long	size = 0;
+    long	skip;			// bytes skipped by readfile_skip_text()
     char_u	*p;
     off_T	filesize = 0;
     int		skip_read = FALSE;
@@ -2113,6 +2116,9 @@ retry:
 			else
 			    p += l - 1;
 		    }
+		    else
+			// Skip over more ASCII quickly.
+			p += readfile_skip_ascii(p + 1, todo - 1);
 		}
 		if (p < ptr + size && !incomplete_tail)
 		{
@@ -2225,7 +2231,13 @@ rewind_retry:
 	    {
 		// catch most common case first
 		if ((c = *ptr) != NUL && c != CAR && c != NL)
+		{
+		    // Skip over more text a word at a time.
+		    skip = readfile_skip_text(ptr + 1, size, TRUE);
+		    ptr += skip;
+		    size -= skip;
 		    continue;
+		}
 		if (c == NUL)
 		    *ptr = NL;	// NULs are replaced by newlines!
 		else if (c == NL)
@@ -2265,7 +2277,13 @@ rewind_retry:
 	    while (++ptr, --size >= 0)
 	    {
 		if ((c = *ptr) != NUL && c != NL)  // catch most common case
+		{
+		    // Skip over more text a word at a time.
+		    skip = readfile_skip_text(ptr + 1, size, FALSE);
+		    ptr += skip;
+		    size -= skip;
 		    continue;
+		}
 		if (c == NUL)
 		    *ptr = NL;	// NULs are replaced by newlines!
 		else
@@ -2800,6 +2818,58 @@ readfile_linenr(
     return lnum;
 }
 
+/*
+ * Masks for checking all bytes of a machine word at once.
+ */
+#define WORD_ONES	    ((long_u)~0L / 0xff)	// 0x0101...01
+#define WORD_HIGH_BITS	    (WORD_ONES * 0x80)		// 0x8080...80
+// Non-zero when a byte in "w" is zero.
+#define WORD_HAS_ZERO(w)    (((w) - WORD_ONES) & ~(w) & WORD_HIGH_BITS)
+
+/*
+ * Return the number of bytes at "p", at most "len", that can be skipped when
+ * looking for the end of a line: they are not NUL, NL or, when "mac" is TRUE,
+ * CR.  Checks a machine word at a time, thus the caller has to check the
+ * bytes after it.
+ */
+    static long
+readfile_skip_text(char_u *p, long len, int mac)
+{
+    long_u  w;
+    long    n = 0;
+
+    while (n + (long)sizeof(long_u) <= len)
+    {
+	mch_memmove(&w, p + n, sizeof(long_u));
+	if (WORD_HAS_ZERO(w) || WORD_HAS_ZERO(w ^ (WORD_ONES * NL))
+			      || (mac && WORD_HAS_ZERO(w ^ (WORD_ONES * CAR))))
+	    break;
+	n += sizeof(long_u);
+    }
+    return n;
+}
+
+/*
+ * Return the number of ASCII bytes at "p", at most "len", that can be
+ * skipped when checking for valid UTF-8.  Like readfile_skip_text() the
+ * caller has to check the bytes after it.
+ */
+    static long
+readfile_skip_ascii(char_u *p, long len)
+{
+    long_u  w;
+    long    n = 0;
+
+    while (n + (long)sizeof(long_u) <= len)
+    {
+	mch_memmove(&w, p + n, sizeof(long_u));
+	if (w & WORD_HIGH_BITS)
+	    break;
+	n += sizeof(long_u);
+    }
+    return n;
+}
+
 /*
  * Fill "*eap" to force the 'fileencoding', 'fileformat' and 'binary' to be
  * equal to the buffer "buf".  Used for calling readfile().
@@ -2611,27 +2611,104 @@ static garray_T	gui_attr_table = {0, 0, 0, 0, NULL};
 #endif
 
 /*
- * Return the attr number for a set of colors and font.
- * Add a new entry to the term_attr_table, cterm_attr_table or gui_attr_table
- * if the combination is new.
- * Return 0 for error (no more room).
+ * Hash index for each of the attribute tables, so that get_attr_entry() can
+ * find an existing entry quickly.  Uses open addressing, "ah_idx" holds the
+ * index in the table plus one, zero for an unused slot.
  */
-    static int
-get_attr_entry(garray_T *table, attrentry_T *aep)
+typedef struct
 {
-    int		i;
-    attrentry_T	*taep;
-    static int	recursive = FALSE;
+    int		*ah_idx;
+    int		ah_size;	// number of slots, a power of two
+} attrhash_T;
 
-    // Init the table, in case it wasn't done yet.
-    table->ga_itemsize = sizeof(attrentry_T);
-    table->ga_growsize = 7;
+static attrhash_T   term_attr_hash = {NULL, 0};
+static attrhash_T   cterm_attr_hash = {NULL, 0};
+#ifdef FEAT_GUI
+static attrhash_T   gui_attr_hash = {NULL, 0};
+#endif
 
-    // Try to find an entry with the same specifications.
-    for (i = 0; i < table->ga_len; ++i)
+/*
+ * Cache for hl_combine_attr(), to avoid building and looking up the combined
+ * entry again for every character that is drawn.  Cleared together with the
+ * attribute tables.
+ */
+#define COMBINE_CACHE_SIZE  512	    // must be a power of two
+
+typedef struct
+{
+    int		cc_char_attr;	// zero for an unused entry
+    int		cc_prim_attr;
+    int		cc_mode;	// COMBINE_MODE_ values
+    int		cc_attr;	// the combined attribute
+} combine_cache_T;
+
+#define COMBINE_MODE_TERM   0
+#define COMBINE_MODE_CTERM  1
+#define COMBINE_MODE_GUI    2
+
+static combine_cache_T	combine_cache[COMBINE_CACHE_SIZE];
+static int		attr_tables_cleared = 0;  // incremented when cleared
+
+    static attrhash_T *
+attr_hash_for(garray_T *table)
+{
+#ifdef FEAT_GUI
+    if (table == &gui_attr_table)
+	return &gui_attr_hash;
+#endif
+    if (table == &term_attr_table)
+	return &term_attr_hash;
+    return &cterm_attr_hash;
+}
+
+/*
+ * Compute a hash value for attribute entry "aep" in "table".
+ */
+    static hash_T
+attr_entry_hash(garray_T *table, attrentry_T *aep)
+{
+    hash_T	hash = (hash_T)aep->ae_attr;
+
+#ifdef FEAT_GUI
+    if (table == &gui_attr_table)
+    {
+	hash = hash * 31 + (hash_T)aep->ae_u.gui.fg_color;
+	hash = hash * 31 + (hash_T)aep->ae_u.gui.bg_color;
+	hash = hash * 31 + (hash_T)aep->ae_u.gui.sp_color;
+	hash = hash * 31 + (hash_T)aep->ae_u.gui.font;
+# ifdef FEAT_XFONTSET
+	hash = hash * 31 + (hash_T)aep->ae_u.gui.fontset;
+# endif
+	return hash;
+    }
+#endif
+    if (table == &term_attr_table)
     {
-	taep = &(((attrentry_T *)table->ga_data)[i]);
-	if (	   aep->ae_attr == taep->ae_attr
+	if (aep->ae_u.term.start != NULL)
+	    hash = hash * 31 + hash_hash(aep->ae_u.term.start);
+	if (aep->ae_u.term.stop != NULL)
+	    hash = hash * 31 + hash_hash(aep->ae_u.term.stop);
+	return hash;
+    }
+    hash = hash * 31 + aep->ae_u.cterm.fg_color;
+    hash = hash * 31 + aep->ae_u.cterm.bg_color;
+    hash = hash * 31 + aep->ae_u.cterm.ul_color;
+    hash = hash * 31 + aep->ae_u.cterm.font;
+#ifdef FEAT_TERMGUICOLORS
+    hash = hash * 31 + (hash_T)aep->ae_u.cterm.fg_rgb;
+    hash = hash * 31 + (hash_T)aep->ae_u.cterm.bg_rgb;
+    hash = hash * 31 + (hash_T)aep->ae_u.cterm.ul_rgb;
+#endif
+    return hash;
+}
+
+/*
+ * Return TRUE if attribute entries "aep" and "taep" in "table" are equal.
+ */
+    static int
+attr_entry_equal(garray_T *table, attrentry_T *aep, attrentry_T *taep)
+{
+    return aep->ae_attr == taep->ae_attr
 		&& (
 #ifdef FEAT_GUI
 		       (table == &gui_attr_table
@@ -2675,11 +2752,93 @@ get_attr_entry(garray_T *table, attrentry_T *aep)
 			    && aep->ae_u.cterm.ul_rgb
 						    == taep->ae_u.cterm.ul_rgb
 #endif
-		       )))
+		       ));
+}
+
+/*
+ * Add entry "idx" of "table" to hash index "ah", growing it when it gets
+ * too full.
+ */
+    static void
+attr_hash_add(attrhash_T *ah, garray_T *table, int idx)
+{
+    int		mask;
+    int		i;
 
-	return i + ATTR_OFF;
+    if ((idx + 1) * 2 > ah->ah_size)
+    {
+	int	newsize = ah->ah_size == 0 ? 64 : ah->ah_size * 2;
+	int	*newidx = ALLOC_CLEAR_MULT(int, newsize);
+
+	if (newidx == NULL)
+	{
+	    // Without an index get_attr_entry() does a linear search.
+	    VIM_CLEAR(ah->ah_idx);
+	    ah->ah_size = 0;
+	    return;
+	}
+	vim_free(ah->ah_idx);
+	ah->ah_idx = newidx;
+	ah->ah_size = newsize;
+	// Add all the entries again, including "idx".
+	mask = newsize - 1;
+	for (idx = 0; idx < table->ga_len; ++idx)
+	{
+	    i = attr_entry_hash(table,
+				     &((attrentry_T *)table->ga_data)[idx]) & mask;
+	    while (ah->ah_idx[i] != 0)
+		i = (i + 1) & mask;
+	    ah->ah_idx[i] = idx + 1;
+	}
+	return;
     }
 
+    mask = ah->ah_size - 1;
+    i = attr_entry_hash(table, &((attrentry_T *)table->ga_data)[idx]) & mask;
+    while (ah->ah_idx[i] != 0)
+	i = (i + 1) & mask;
+    ah->ah_idx[i] = idx + 1;
+}
+
+/*
+ * Return the attr number for a set of colors and font.
+ * Add a new entry to the term_attr_table, cterm_attr_table or gui_attr_table
+ * if the combination is new.
+ * Return 0 for error (no more room).
+ */
+    static int
+get_attr_entry(garray_T *table, attrentry_T *aep)
+{
+    int		i;
+    attrentry_T	*taep;
+    attrhash_T	*ah;
+    int		mask;
+    static int	recursive = FALSE;
+
+    // Init the table, in case it wasn't done yet.
+    table->ga_itemsize = sizeof(attrentry_T);
+    table->ga_growsize = 7;
+
+    // Try to find an entry with the same specifications.
+    ah = attr_hash_for(table);
+    if (ah->ah_size > 0)
+    {
+	mask = ah->ah_size - 1;
+	for (i = attr_entry_hash(table, aep) & mask; ah->ah_idx[i] != 0;
+							    i = (i + 1) & mask)
+	{
+	    taep = &(((attrentry_T *)table->ga_data)[ah->ah_idx[i] - 1]);
+	    if (attr_entry_equal(table, aep, taep))
+		return ah->ah_idx[i] - 1 + ATTR_OFF;
+	}
+    }
+    else
+	// No index, out of memory.
+	for (i = 0; i < table->ga_len; ++i)
+	    if (attr_entry_equal(table, aep,
+					 &(((attrentry_T *)table->ga_data)[i])))
+		return i + ATTR_OFF;
+
     if (table->ga_len + ATTR_OFF > MAX_TYPENR)
     {
 	// Running out of attribute entries!  remove all attributes, and
@@ -2745,6 +2904,7 @@ get_attr_entry(garray_T *table, attrentry_T *aep)
 #endif
     }
     ++table->ga_len;
+    attr_hash_add(attr_hash_for(table), table, table->ga_len - 1);
     return (table->ga_len - 1 + ATTR_OFF);
 }
 
@@ -2840,28 +3000,30 @@ clear_hl_tables(void)
     }
     ga_clear(&term_attr_table);
     ga_clear(&cterm_attr_table);
+
+    VIM_CLEAR(term_attr_hash.ah_idx);
+    term_attr_hash.ah_size = 0;
+    VIM_CLEAR(cterm_attr_hash.ah_idx);
+    cterm_attr_hash.ah_size = 0;
+#ifdef FEAT_GUI
+    VIM_CLEAR(gui_attr_hash.ah_idx);
+    gui_attr_hash.ah_size = 0;
+#endif
+    CLEAR_FIELD(combine_cache);
+    ++attr_tables_cleared;
 }
 
 /*
- * Combine special attributes (e.g., for spelling) with other attributes
- * (e.g., for syntax highlighting).
- * "prim_attr" overrules "char_attr".
- * This creates a new group when required.
- * Since we expect there to be few spelling mistakes we don't cache the
- * result.
- * Return the resulting attributes.
+ * Combine attributes "char_attr" and "prim_attr" by looking up or creating
+ * the entry for the combination.  Used by hl_combine_attr().
  */
-    int
-hl_combine_attr(int char_attr, int prim_attr)
+    static int
+hl_combine_attr_entry(int char_attr, int prim_attr)
 {
     attrentry_T *char_aep = NULL;
     attrentry_T *prim_aep;
     attrentry_T new_en;
 
-    if (char_attr == 0)
-	return prim_attr;
-    if (char_attr <= HL_ALL && prim_attr <= HL_ALL)
-	return ATTR_COMBINE(char_attr, prim_attr);
 #ifdef FEAT_GUI
     if (gui.in_use)
     {
@@ -2996,6 +3158,54 @@ hl_combine_attr(int char_attr, int prim_attr)
     return get_attr_entry(&term_attr_table, &new_en);
 }
 
+/*
+ * Combine special attributes (e.g., for spelling) with other attributes
+ * (e.g., for syntax highlighting).
+ * "prim_attr" overrules "char_attr".
+ * This creates a new group when required.
+ * This is done for every character drawn with a match, text property,
+ * 'cursorline', etc., the result is cached.
+ * Return the resulting attributes.
+ */
+    int
+hl_combine_attr(int char_attr, int prim_attr)
+{
+    combine_cache_T *cc;
+    int		    mode;
+    int		    cleared = attr_tables_cleared;
+    int		    attr;
+
+    if (char_attr == 0)
+	return prim_attr;
+    if (char_attr <= HL_ALL && prim_attr <= HL_ALL)
+	return ATTR_COMBINE(char_attr, prim_attr);
+
+#ifdef FEAT_GUI
+    if (gui.in_use)
+	mode = COMBINE_MODE_GUI;
+    else
+#endif
+	mode = IS_CTERM ? COMBINE_MODE_CTERM : COMBINE_MODE_TERM;
+    cc = &combine_cache[((unsigned)char_attr * 31 + (unsigned)prim_attr)
+						   & (COMBINE_CACHE_SIZE - 1)];
+    if (cc->cc_char_attr == char_attr && cc->cc_prim_attr == prim_attr
+							 && cc->cc_mode == mode)
+	return cc->cc_attr;
+
+    attr = hl_combine_attr_entry(char_attr, prim_attr);
+
+    // When the tables were cleared the attribute numbers changed meaning,
+    // don't cache the result then.
+    if (attr != 0 && cleared == attr_tables_cleared)
+    {
+	cc->cc_char_attr = char_attr;
+	cc->cc_prim_attr = prim_attr;
+	cc->cc_mode = mode;
+	cc->cc_attr = attr;
+    }
+    return attr;
+}
+
 #ifdef FEAT_GUI
     attrentry_T *
 syn_gui_attr2entry(int attr)
@@ -62,6 +62,25 @@ extern int dos2;			// this is in os_amiga.c
 #endif
 
 #define MEMFILE_PAGE_SIZE 4096		// default page size
+#define MEMFILE_MAX_PAGE_SIZE 65536	// maximum page size for a large file
+#define MEMFILE_HINT_PAGES 4096		// use larger pages above this number
+
+#ifdef HAVE_AIO
+# include <aio.h>
+
+/*
+ * A write or fsync of the swap file that was queued with aio_write() or
+ * aio_fsync() and may still be in progress.  The data written is a copy of
+ * the block, the block itself may be changed or freed in the meantime.
+ */
+struct mf_aio_S
+{
+    mf_aio_T	*ma_next;
+    struct aiocb ma_cb;		// the request
+    blocknr_T	ma_bnum;	// block number being written
+    char_u	*ma_data;	// copy of the block data, NULL for fsync
+};
+#endif
 
 static long_u	total_mem_used = 0;	// total memory used for memfiles
 
@@ -69,6 +88,7 @@ static void mf_ins_hash(memfile_T *, bhdr_T *);
 static void mf_rem_hash(memfile_T *, bhdr_T *);
 static bhdr_T *mf_find_hash(memfile_T *, blocknr_T);
 static void mf_ins_used(memfile_T *, bhdr_T *);
+static void mf_ins_cold(memfile_T *, bhdr_T *);
 static void mf_rem_used(memfile_T *, bhdr_T *);
 static bhdr_T *mf_release(memfile_T *, int);
 static bhdr_T *mf_alloc_bhdr(memfile_T *, int);
@@ -76,8 +96,13 @@ static void mf_free_bhdr(bhdr_T *);
 static void mf_ins_free(memfile_T *, bhdr_T *);
 static bhdr_T *mf_rem_free(memfile_T *);
 static int  mf_read(memfile_T *, bhdr_T *);
-static int  mf_write(memfile_T *, bhdr_T *);
+static int  mf_write(memfile_T *, bhdr_T *, int);
 static int  mf_write_block(memfile_T *mfp, bhdr_T *hp, off_T offset, unsigned size);
+#ifdef HAVE_AIO
+static int  mf_aio_write(memfile_T *mfp, bhdr_T *hp, off_T offset, unsigned size);
+static int  mf_aio_fsync(memfile_T *mfp);
+static int  mf_aio_check(memfile_T *mfp, int wait);
+#endif
 static int  mf_trans_add(memfile_T *, bhdr_T *);
 static void mf_do_open(memfile_T *, char_u *, int);
 static void mf_hash_init(mf_hashtab_T *);
@@ -87,11 +112,13 @@ static mf_hashitem_T *mf_hash_find(mf_hashtab_T *, blocknr_T);
 static void mf_hash_add_item(mf_hashtab_T *, mf_hashitem_T *);
 static void mf_hash_rem_item(mf_hashtab_T *, mf_hashitem_T *);
 static int mf_hash_grow(mf_hashtab_T *);
+static void mf_set_used_count_max(memfile_T *mfp);
 
 /*
  * The functions for using a memfile:
  *
  * mf_open()	    open a new or existing memfile
+ * mf_size_hint()   adjust the page size of a new memfile to the file size
  * mf_open_file()   open a swap file for an existing memfile
  * mf_close()	    close (and delete) a memfile
  * mf_new()	    create a new block in a memfile and lock it
@@ -99,6 +126,7 @@ static int mf_hash_grow(mf_hashtab_T *);
  * mf_put()	    unlock a block, may be marked for writing
  * mf_free()	    remove a block
  * mf_sync()	    sync changed parts of memfile to disk
+ * mf_sync_wait()   wait for background writes of mf_sync() to finish
  * mf_release_all() release as much memory as possible
  * mf_trans_del()   may translate negative to positive block number
  * mf_fullname()    make file name full path (use before first :cd)
@@ -150,8 +178,16 @@ mf_open(char_u *fname, int flags)
     mfp->mf_free_first = NULL;		// free list is empty
     mfp->mf_used_first = NULL;		// used list is empty
     mfp->mf_used_last = NULL;
+    mfp->mf_cold_first = NULL;
     mfp->mf_dirty = MF_DIRTY_NO;
+    mfp->mf_pin_count = 0;
+    mfp->mf_keep_dirty = FALSE;
+    mfp->mf_need_checkpoint = FALSE;
+#ifdef HAVE_AIO
+    mfp->mf_aio = NULL;
+#endif
     mfp->mf_used_count = 0;
+    mfp->mf_cold_count = 0;
     mf_hash_init(&mfp->mf_hash);
     mf_hash_init(&mfp->mf_trans);
     mfp->mf_page_size = MEMFILE_PAGE_SIZE;
@@ -184,26 +220,54 @@ mf_open(char_u *fname, int flags)
     mfp->mf_neg_count = 0;
     mfp->mf_infile_count = mfp->mf_blocknr_max;
 
-    /*
-     * Compute maximum number of pages ('maxmem' is in Kbyte):
-     *	'mammem' * 1Kbyte / page-size-in-bytes.
-     * Avoid overflow by first reducing page size as much as possible.
-     */
-    {
-	int	    shift = 10;
-	unsigned    page_size = mfp->mf_page_size;
+    mf_set_used_count_max(mfp);
 
-	while (shift > 0 && (page_size & 1) == 0)
-	{
-	    page_size = page_size >> 1;
-	    --shift;
-	}
-	mfp->mf_used_count_max = (p_mm << shift) / page_size;
-	if (mfp->mf_used_count_max < 10)
-	    mfp->mf_used_count_max = 10;
+    return mfp;
+}
+
+/*
+ * Compute maximum number of pages ('maxmem' is in Kbyte):
+ *	'mammem' * 1Kbyte / page-size-in-bytes.
+ * Avoid overflow by first reducing page size as much as possible.
+ */
+    static void
+mf_set_used_count_max(memfile_T *mfp)
+{
+    int		shift = 10;
+    unsigned    page_size = mfp->mf_page_size;
+
+    while (shift > 0 && (page_size & 1) == 0)
+    {
+	page_size = page_size >> 1;
+	--shift;
     }
+    mfp->mf_used_count_max = (p_mm << shift) / page_size;
+    if (mfp->mf_used_count_max < 10)
+	mfp->mf_used_count_max = 10;
+}
 
-    return mfp;
+/*
+ * Adjust the page size of new memfile "mfp" for storing a file of "size"
+ * bytes.  For a large file larger pages are used, this keeps the number of
+ * blocks down, which makes finding a line and writing the swap file faster.
+ * Must be called before any block is allocated.  The page size is stored in
+ * block 0, thus the swap file can be recovered by any Vim version.
+ */
+    void
+mf_size_hint(memfile_T *mfp, off_T size)
+{
+    unsigned	page_size = mfp->mf_page_size;
+
+    if (mfp->mf_used_first != NULL)
+	return;
+    while (page_size < MEMFILE_MAX_PAGE_SIZE
+				     && size / page_size > MEMFILE_HINT_PAGES)
+	page_size <<= 1;
+    if (page_size != mfp->mf_page_size)
+    {
+	mfp->mf_page_size = page_size;
+	mf_set_used_count_max(mfp);
+    }
 }
 
 /*
@@ -238,6 +302,7 @@ mf_close(memfile_T *mfp, int del_file)
 
     if (mfp == NULL)		    // safety check
 	return;
+    mf_sync_wait(mfp);
     if (mfp->mf_fd >= 0)
     {
 	if (close(mfp->mf_fd) < 0)
@@ -286,6 +351,8 @@ mf_close_file(
 	// TODO: should check if all blocks are really in core
     }
 
+    ml_journal_close(buf, TRUE);
+    mf_sync_wait(mfp);
     if (close(mfp->mf_fd) < 0)			// close the file
 	emsg(_(e_close_error_on_swap_file));
     mfp->mf_fd = -1;
@@ -410,6 +477,7 @@ mf_new(memfile_T *mfp, int negative, int page_count)
 mf_get(memfile_T *mfp, blocknr_T nr, int page_count)
 {
     bhdr_T    *hp;
+    int	      cold = FALSE;
 						// doesn't exist
     if (nr >= mfp->mf_blocknr_max || nr <= mfp->mf_blocknr_min)
 	return NULL;
@@ -444,6 +512,7 @@ mf_get(memfile_T *mfp, blocknr_T nr, int page_count)
 	    mf_free_bhdr(hp);
 	    return NULL;
 	}
+	cold = TRUE;
     }
     else
     {
@@ -452,7 +521,10 @@ mf_get(memfile_T *mfp, blocknr_T nr, int page_count)
     }
 
     hp->bh_flags |= BH_LOCKED;
-    mf_ins_used(mfp, hp);	// put in front of used list
+    if (cold)
+	mf_ins_cold(mfp, hp);	// put in front of cold blocks
+    else
+	mf_ins_used(mfp, hp);	// put in front of used list
     mf_ins_hash(mfp, hp);	// put in front of hash list
 
     return hp;
@@ -519,15 +591,25 @@ mf_free(memfile_T *mfp, bhdr_T *hp)
  *  MFS_FLUSH	Make sure buffers are flushed to disk, so they will survive a
  *		system crash.
  *  MFS_ZERO	Only write block 0.
+ *  MFS_ASYNC	Queue the writes and the flush to be done in the background,
+ *		so that a slow file system does not make Vim hang.  If writes
+ *		queued before are still in progress nothing is done, the
+ *		memfile stays dirty.  Without this flag background writes are
+ *		waited for before writing.
  *
  * Return FAIL for failure, OK otherwise
  */
     int
 mf_sync(memfile_T *mfp, int flags)
 {
-    int		status;
+    int		status = OK;
     bhdr_T	*hp;
     int		got_int_save = got_int;
+    int		async = FALSE;
+#ifdef HAVE_AIO
+    int		did_write = FALSE;
+    int		aio_status;
+#endif
 
     if (mfp->mf_fd < 0)
     {
@@ -536,6 +618,17 @@ mf_sync(memfile_T *mfp, int flags)
 	return FAIL;
     }
 
+#ifdef HAVE_AIO
+    // Collect the results of previous background writes.  A block must not
+    // be written again while an earlier write of it may still be busy, thus
+    // when some are in progress try again later.  A block that failed to
+    // be written is dirty again and is written below.
+    aio_status = mf_aio_check(mfp, (flags & MFS_ASYNC) == 0);
+    if (mfp->mf_aio != NULL)
+	return aio_status;
+    async = (flags & MFS_ASYNC) != 0;
+#endif
+
     // Only a CTRL-C while writing will break us here, not one typed
     // previously.
     got_int = FALSE;
@@ -546,7 +639,6 @@ mf_sync(memfile_T *mfp, int flags)
      * Then we only try to write blocks within the existing file. If that also
      * fails then we give up.
      */
-    status = OK;
     for (hp = mfp->mf_used_last; hp != NULL; hp = hp->bh_prev)
 	if (((flags & MFS_ALL) || hp->bh_bnum >= 0)
 		&& (hp->bh_flags & BH_DIRTY)
@@ -555,12 +647,16 @@ mf_sync(memfile_T *mfp, int flags)
 	{
 	    if ((flags & MFS_ZERO) && hp->bh_bnum != 0)
 		continue;
-	    if (mf_write(mfp, hp) == FAIL)
+	    if (mf_write(mfp, hp, async) == FAIL)
 	    {
 		if (status == FAIL)	// double error: quit syncing
 		    break;
 		status = FAIL;
 	    }
+#ifdef HAVE_AIO
+	    else
+		did_write = TRUE;
+#endif
 	    if (flags & MFS_STOP)
 	    {
 		// Stop when char available now.
@@ -580,6 +676,22 @@ mf_sync(memfile_T *mfp, int flags)
     if (hp == NULL || status == FAIL)
 	mfp->mf_dirty = MF_DIRTY_NO;
 
+#ifdef HAVE_AIO
+    // When writing in the background the fsync() is queued after the writes.
+    // When nothing was written there is nothing to flush.  Otherwise the
+    // writes must be done before calling sync() or fsync() below.
+    if (async && (flags & MFS_FLUSH))
+    {
+	if (!did_write || *p_sws == NUL || (STRCMP(p_sws, "fsync") == 0
+						  && mf_aio_fsync(mfp) == OK))
+	    flags &= ~MFS_FLUSH;
+	else if (mf_aio_check(mfp, TRUE) == FAIL)
+	    status = FAIL;
+    }
+    if (aio_status == FAIL)
+	status = FAIL;
+#endif
+
     if ((flags & MFS_FLUSH) && *p_sws != NUL)
     {
 #if defined(UNIX)
@@ -661,6 +773,33 @@ mf_sync(memfile_T *mfp, int flags)
     return status;
 }
 
+/*
+ * Wait for the background writes queued by mf_sync() to finish.  Must be done
+ * before the swap file is closed.
+ */
+    void
+mf_sync_wait(memfile_T *mfp UNUSED)
+{
+#ifdef HAVE_AIO
+    if (mfp->mf_aio != NULL)
+	(void)mf_aio_check(mfp, TRUE);
+#endif
+}
+
+/*
+ * Return TRUE if background writes queued by mf_sync() may still be in
+ * progress.
+ */
+    int
+mf_sync_pending(memfile_T *mfp UNUSED)
+{
+#ifdef HAVE_AIO
+    return mfp->mf_aio != NULL;
+#else
+    return FALSE;
+#endif
+}
+
 /*
  * For all blocks in memory file *mfp that have a positive block number set
  * the dirty flag.  These are blocks that need to be written to a newly
@@ -721,6 +860,35 @@ mf_ins_used(memfile_T *mfp, bhdr_T *hp)
     total_mem_used += (long_u)hp->bh_page_count * mfp->mf_page_size;
 }
 
+/*
+ * insert block *hp in front of the cold blocks in the used list of memfile
+ * *mfp, for a block that was read from the file
+ */
+    static void
+mf_ins_cold(memfile_T *mfp, bhdr_T *hp)
+{
+    hp->bh_next = mfp->mf_cold_first;
+    if (hp->bh_next == NULL)	    // no cold blocks, append to the list
+    {
+	hp->bh_prev = mfp->mf_used_last;
+	mfp->mf_used_last = hp;
+    }
+    else
+    {
+	hp->bh_prev = hp->bh_next->bh_prev;
+	hp->bh_next->bh_prev = hp;
+    }
+    if (hp->bh_prev == NULL)	    // list was empty, adjust first pointer
+	mfp->mf_used_first = hp;
+    else
+	hp->bh_prev->bh_next = hp;
+    mfp->mf_cold_first = hp;
+    hp->bh_flags |= BH_COLD;
+    mfp->mf_cold_count += hp->bh_page_count;
+    mfp->mf_used_count += hp->bh_page_count;
+    total_mem_used += (long_u)hp->bh_page_count * mfp->mf_page_size;
+}
+
 /*
  * remove block *hp from used list of memfile *mfp
  */
@@ -735,6 +903,13 @@ mf_rem_used(memfile_T *mfp, bhdr_T *hp)
 	mfp->mf_used_first = hp->bh_next;
     else
 	hp->bh_prev->bh_next = hp->bh_next;
+    if (hp->bh_flags & BH_COLD)
+    {
+	if (mfp->mf_cold_first == hp)
+	    mfp->mf_cold_first = hp->bh_next;
+	mfp->mf_cold_count -= hp->bh_page_count;
+	hp->bh_flags &= ~BH_COLD;
+    }
     mfp->mf_used_count -= hp->bh_page_count;
     total_mem_used -= (long_u)hp->bh_page_count * mfp->mf_page_size;
 }
@@ -755,8 +930,8 @@ mf_release(memfile_T *mfp, int page_count)
     int		need_release;
     buf_T	*buf;
 
-    // don't release while in mf_close_file()
-    if (mf_dont_release)
+    // don't release while in mf_close_file() or when a line is pinned
+    if (mf_dont_release || mfp->mf_pin_count > 0)
 	return NULL;
 
     /*
@@ -791,19 +966,44 @@ mf_release(memfile_T *mfp, int page_count)
     if (mfp->mf_fd < 0 || !need_release)
 	return NULL;
 
-    for (hp = mfp->mf_used_last; hp != NULL; hp = hp->bh_prev)
-	if (!(hp->bh_flags & BH_LOCKED))
-	    break;
+    /*
+     * Cold blocks are at the end of the list and are released first.  When
+     * there are only a few release the least recently used other block,
+     * so that a block read from the file can stay long enough to be used
+     * again.  Then it is no longer cold.
+     */
+    hp = NULL;
+    if (mfp->mf_cold_count < mfp->mf_used_count_max / 4)
+	for (hp = mfp->mf_cold_first == NULL ? mfp->mf_used_last
+				  : mfp->mf_cold_first->bh_prev; hp != NULL;
+							      hp = hp->bh_prev)
+	    if (!(hp->bh_flags & BH_LOCKED) && !(mfp->mf_keep_dirty
+						 && (hp->bh_flags & BH_DIRTY)))
+		break;
+    if (hp == NULL)
+	for (hp = mfp->mf_used_last; hp != NULL; hp = hp->bh_prev)
+	    if (!(hp->bh_flags & BH_LOCKED) && !(mfp->mf_keep_dirty
+						 && (hp->bh_flags & BH_DIRTY)))
+		break;
     if (hp == NULL)	// not a single one that can be released
+    {
+	// Changed blocks are kept for the journal, a checkpoint is needed to
+	// be able to release them.
+	if (mfp->mf_keep_dirty)
+	    mfp->mf_need_checkpoint = TRUE;
 	return NULL;
+    }
 
     /*
      * If the block is dirty, write it.
      * If the write fails we don't free it.
      */
-    if ((hp->bh_flags & BH_DIRTY) && mf_write(mfp, hp) == FAIL)
+    if ((hp->bh_flags & BH_DIRTY) && mf_write(mfp, hp, FALSE) == FAIL)
 	return NULL;
 
+    // When the block is read back its background write must be finished.
+    mf_sync_wait(mfp);
+
     mf_rem_used(mfp, hp);
     mf_rem_hash(mfp, hp);
 
@@ -849,14 +1049,16 @@ mf_release_all(void)
 	    if (mfp->mf_fd < 0 && buf->b_may_swap)
 		ml_open_file(buf);
 
-	    // only if there is a swapfile
-	    if (mfp->mf_fd >= 0)
+	    // only if there is a swapfile and no line is pinned
+	    if (mfp->mf_fd >= 0 && mfp->mf_pin_count == 0)
 	    {
+		mf_sync_wait(mfp);
 		for (hp = mfp->mf_used_last; hp != NULL; )
 		{
 		    if (!(hp->bh_flags & BH_LOCKED)
 			    && (!(hp->bh_flags & BH_DIRTY)
-				|| mf_write(mfp, hp) != FAIL))
+				|| (!mfp->mf_keep_dirty
+					&& mf_write(mfp, hp, FALSE) != FAIL)))
 		    {
 			mf_rem_used(mfp, hp);
 			mf_rem_hash(mfp, hp);
@@ -865,7 +1067,11 @@ mf_release_all(void)
 			retval = TRUE;
 		    }
 		    else
+		    {
+			if (mfp->mf_keep_dirty && (hp->bh_flags & BH_DIRTY))
+			    mfp->mf_need_checkpoint = TRUE;
 			hp = hp->bh_prev;
+		    }
 		}
 	    }
 	}
@@ -968,11 +1174,13 @@ mf_read(memfile_T *mfp, bhdr_T *hp)
 
 /*
  * write a block to disk
+ * When "async" is TRUE the write is queued to be done in the background, if
+ * possible.
  *
  * Return FAIL for failure, OK otherwise
  */
     static int
-mf_write(memfile_T *mfp, bhdr_T *hp)
+mf_write(memfile_T *mfp, bhdr_T *hp, int async)
 {
     off_T	offset;	    // offset in the file
     blocknr_T	nr;	    // block nr which is being written
@@ -989,6 +1197,10 @@ mf_write(memfile_T *mfp, bhdr_T *hp)
 	if (mf_trans_add(mfp, hp) == FAIL)
 	    return FAIL;
 
+    // A background write of this block must not finish after this one.
+    if (!async)
+	mf_sync_wait(mfp);
+
     page_size = mfp->mf_page_size;
 
     /*
@@ -1021,6 +1233,11 @@ mf_write(memfile_T *mfp, bhdr_T *hp)
 	{
 	    if (mfp->mf_fd >= 0)
 	    {
+#ifdef HAVE_AIO
+		if (async && mf_aio_write(mfp, hp2 == NULL ? hp : hp2,
+						       offset, size) == OK)
+		    break;
+#endif
 		if (vim_lseek(mfp->mf_fd, offset, SEEK_SET) != offset)
 		{
 		    PERROR(_(e_seek_error_in_swap_file_write));
@@ -1037,7 +1254,11 @@ mf_write(memfile_T *mfp, bhdr_T *hp)
 		// gets disconnected and then re-connected, we can maybe fix it
 		// by closing and then re-opening the file.
 		if (mfp->mf_fd >= 0)
+		{
+		    // Background writes must not use the closed file.
+		    mf_sync_wait(mfp);
 		    close(mfp->mf_fd);
+		}
 		mfp->mf_fd = mch_open_rw((char *)mfp->mf_fname, mfp->mf_flags);
 		mfp->mf_reopen = (mfp->mf_fd < 0);
 	    }
@@ -1102,6 +1323,143 @@ mf_write_block(
     return result;
 }
 
+#ifdef HAVE_AIO
+/*
+ * Queue writing block "hp" with data size "size" at "offset" in the swap file
+ * to be done in the background.  The data is copied (and encrypted), the
+ * block may be changed or freed before the write is done.
+ * Return FAIL when the write could not be queued, the caller then has to
+ * write the block itself.
+ */
+    static int
+mf_aio_write(
+    memfile_T	*mfp,
+    bhdr_T	*hp,
+    off_T	offset,
+    unsigned	size)
+{
+    mf_aio_T	*ap;
+    char_u	*data = hp->bh_data;
+
+# ifdef FEAT_CRYPT
+    // Encrypt if 'key' is set and this is a data block.
+    if (*mfp->mf_buffer->b_p_key != NUL)
+    {
+	data = ml_encrypt_data(mfp, data, offset, size);
+	if (data == NULL)
+	    return FAIL;
+    }
+# endif
+    if (data == hp->bh_data && (data = vim_memsave(data, size)) == NULL)
+	return FAIL;
+
+    ap = ALLOC_CLEAR_ONE(mf_aio_T);
+    if (ap == NULL)
+    {
+	vim_free(data);
+	return FAIL;
+    }
+    ap->ma_bnum = hp->bh_bnum;
+    ap->ma_data = data;
+    ap->ma_cb.aio_fildes = mfp->mf_fd;
+    ap->ma_cb.aio_buf = data;
+    ap->ma_cb.aio_nbytes = size;
+    ap->ma_cb.aio_offset = offset;
+    ap->ma_cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+    if (aio_write(&ap->ma_cb) < 0)
+    {
+	vim_free(data);
+	vim_free(ap);
+	return FAIL;
+    }
+    ap->ma_next = mfp->mf_aio;
+    mfp->mf_aio = ap;
+    return OK;
+}
+
+/*
+ * Queue an fsync() of the swap file, to be done in the background after the
+ * writes queued before it.
+ * Return FAIL when it could not be queued.
+ */
+    static int
+mf_aio_fsync(memfile_T *mfp)
+{
+    mf_aio_T	*ap;
+
+    ap = ALLOC_CLEAR_ONE(mf_aio_T);
+    if (ap == NULL)
+	return FAIL;
+    ap->ma_cb.aio_fildes = mfp->mf_fd;
+    ap->ma_cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+    if (aio_fsync(O_SYNC, &ap->ma_cb) < 0)
+    {
+	vim_free(ap);
+	return FAIL;
+    }
+    ap->ma_next = mfp->mf_aio;
+    mfp->mf_aio = ap;
+    return OK;
+}
+
+/*
+ * Collect the results of background writes that have finished.  When "wait"
+ * is TRUE wait for all of them to finish.
+ * A block that could not be written is marked dirty again, so that the next
+ * sync writes it.  An error message is given for a failed write or fsync.
+ * Return FAIL if a write or fsync failed, OK otherwise.
+ */
+    static int
+mf_aio_check(memfile_T *mfp, int wait)
+{
+    mf_aio_T	**app = &mfp->mf_aio;
+    mf_aio_T	*ap;
+    bhdr_T	*hp;
+    int		err;
+    int		status = OK;
+
+    while ((ap = *app) != NULL)
+    {
+	err = aio_error(&ap->ma_cb);
+	if (err == EINPROGRESS)
+	{
+	    if (wait)
+	    {
+		const struct aiocb *list[1];
+
+		list[0] = &ap->ma_cb;
+		(void)aio_suspend(list, 1, NULL);
+	    }
+	    else
+		app = &ap->ma_next;
+	    continue;
+	}
+
+	*app = ap->ma_next;
+	if (aio_return(&ap->ma_cb) != (ssize_t)ap->ma_cb.aio_nbytes
+								    || err != 0)
+	{
+	    status = FAIL;
+	    if (ap->ma_data != NULL)
+	    {
+		hp = mf_find_hash(mfp, ap->ma_bnum);
+		if (hp != NULL)
+		{
+		    hp->bh_flags |= BH_DIRTY;
+		    mfp->mf_dirty = MF_DIRTY_YES;
+		}
+	    }
+	    if (!did_swapwrite_msg)
+		emsg(_(e_write_error_in_swap_file));
+	    did_swapwrite_msg = TRUE;
+	}
+	vim_free(ap->ma_data);
+	vim_free(ap);
+    }
+    return status;
+}
+#endif
+
 /*
  * Make block number for *hp positive and add it to the translation list
  *
@@ -235,6 +235,24 @@ static linenr_T	lowest_marked = 0;
 #define ML_FLUSH	0x02	    // flush locked block
 #define ML_SIMPLE(x)	((x) & 0x10)  // DEL, INS or FIND
 
+/*
+ * The swap file journal ('swapjournal').  The file starts with a header:
+ *	JOURNAL_MAGIC, process ID of the swap file (4 bytes)
+ * followed by records:
+ *	operation (1 byte), line number (4 bytes), text length (4 bytes), text
+ * The operations are JOURNAL_APPEND (append the text after the line),
+ * JOURNAL_DELETE (delete the line, the text is empty) and JOURNAL_REPLACE
+ * (replace the line with the text).  Text properties are not included.
+ */
+#define JOURNAL_MAGIC	    "VimJrnl1"
+#define JOURNAL_HDR_SIZE    12
+#define JOURNAL_REC_SIZE    9
+#define JOURNAL_MAX_SIZE    (1024L * 1024L) // checkpoint when journal is
+						// bigger than this
+#define JOURNAL_APPEND	    'a'
+#define JOURNAL_DELETE	    'd'
+#define JOURNAL_REPLACE	    'r'
+
 // argument for ml_upd_block0()
 typedef enum {
       UB_FNAME = 0	// update timestamp and filename
@@ -252,6 +270,15 @@ static void add_b0_fenc(ZERO_BL *b0p, buf_T *buf);
 static time_t swapfile_info(char_u *);
 static int recov_file_names(char_u **, char_u *, int prepend_dot);
 static char_u *findswapname(buf_T *, char_u **, char_u *);
+static char_u *ml_journal_name(char_u *swapname);
+static int ml_journal_start(buf_T *buf);
+static int ml_update_pointers(buf_T *buf);
+static int ml_journal_sync(buf_T *buf);
+static void ml_journal_write(buf_T *buf, int flush);
+static void ml_journal_add(buf_T *buf, int op, linenr_T lnum, char_u *text, int len);
+static void ml_journal_check(buf_T *buf);
+static void ml_journal_replay(char_u *swapname, long pid, linenr_T *lnump, long *errorp);
+static void ml_insert_in_block(buf_T *buf, DATA_BL *dp, int db_idx, int line_count, char_u *line, colnr_T len, int flags);
 static void ml_flush_line(buf_T *);
 static bhdr_T *ml_new_data(memfile_T *, int, int);
 static bhdr_T *ml_new_ptr(memfile_T *);
@@ -269,6 +296,9 @@ static cryptstate_T *ml_crypt_prepare(memfile_T *mfp, off_T offset, int reading)
 #endif
 #ifdef FEAT_BYTEOFF
 static void ml_updatechunk(buf_T *buf, long line, long len, int updtype);
+static int ml_chunktree_build(buf_T *buf);
+static void ml_chunktree_add(buf_T *buf, int idx, int lines, long size);
+static int ml_chunktree_find(buf_T *buf, linenr_T lnum, long offset, int ffdos, linenr_T *linep, long *sizep);
 #endif
 
 /*
@@ -284,6 +314,7 @@ ml_open(buf_T *buf)
     ZERO_BL	*b0p;
     PTR_BL	*pp;
     DATA_BL	*dp;
+    stat_T	st;
 
     /*
      * init fields in memline struct
@@ -296,6 +327,7 @@ ml_open(buf_T *buf)
 #ifdef FEAT_BYTEOFF
     buf->b_ml.ml_chunksize = NULL;
     buf->b_ml.ml_usedchunks = 0;
+    buf->b_ml.ml_chunktree = NULL;
 #endif
 
     if (cmdmod.cmod_flags & CMOD_NOSWAPFILE)
@@ -320,6 +352,9 @@ ml_open(buf_T *buf)
 #ifdef FEAT_CRYPT
     mfp->mf_buffer = buf;
 #endif
+    // A large file is going to be read, use larger blocks.
+    if (buf->b_ffname != NULL && mch_stat((char *)buf->b_ffname, &st) == 0)
+	mf_size_hint(mfp, (off_T)st.st_size);
     buf->b_ml.ml_flags = ML_EMPTY;
     buf->b_ml.ml_line_count = 1;
 
@@ -533,6 +568,9 @@ ml_set_crypt_key(
 	buf->b_p_key = new_key;
 	buf->b_p_cm = new_buf_cm;
     }
+    // The journal is not encrypted, don't use it with a key.
+    if (*buf->b_p_key != NUL)
+	ml_journal_close(buf, TRUE);
 
     // Set the key, method and seed to be used for reading, these must be the
     // old values.
@@ -708,9 +746,15 @@ ml_setname(buf_T *buf)
 	    success = TRUE;
 	    break;
 	}
-	// need to close the swap file before renaming
+	// need to close the swap file before renaming, the journal is started
+	// again with the next checkpoint; the swap file must contain all
+	// changes before the journal is deleted
 	if (mfp->mf_fd >= 0)
 	{
+	    if (buf->b_ml.ml_journal != NULL)
+		ml_preserve(buf, FALSE);
+	    ml_journal_close(buf, TRUE);
+	    mf_sync_wait(mfp);
 	    close(mfp->mf_fd);
 	    mfp->mf_fd = -1;
 	}
@@ -878,6 +922,11 @@ ml_close(buf_T *buf, int del_file)
 {
     if (buf->b_ml.ml_mfp == NULL)		// not open
 	return;
+    // When keeping the swap file it must contain all changes before the
+    // journal is deleted.
+    if (!del_file && buf->b_ml.ml_journal != NULL)
+	ml_preserve(buf, FALSE);
+    ml_journal_close(buf, TRUE);
     mf_close(buf->b_ml.ml_mfp, del_file);	// close the .swp file
     if (buf->b_ml.ml_line_lnum != 0
 		      && (buf->b_ml.ml_flags & (ML_LINE_DIRTY | ML_ALLOCATED)))
@@ -885,6 +934,7 @@ ml_close(buf_T *buf, int del_file)
     vim_free(buf->b_ml.ml_stack);
 #ifdef FEAT_BYTEOFF
     VIM_CLEAR(buf->b_ml.ml_chunksize);
+    VIM_CLEAR(buf->b_ml.ml_chunktree);
 #endif
     buf->b_ml.ml_mfp = NULL;
 
@@ -1196,6 +1246,7 @@ ml_recover(int checkext)
     int		called_from_main;
     int		serious_error = TRUE;
     long	mtime;
+    long	b0_pid;
     int		attr;
     int		orig_file_status = NOTDONE;
 
@@ -1452,6 +1503,7 @@ ml_recover(int checkext)
 	    ;
 	b0_fenc = vim_strnsave(p, b0p->b0_fname + fnsize - p);
     }
+    b0_pid = char_to_long(b0p->b0_pid);
 
     mf_put(mfp, hp, FALSE, FALSE);	// release block 0
     hp = NULL;
@@ -1730,6 +1782,10 @@ ml_recover(int checkext)
 	page_count = 1;
     }
 
+    // Apply the changes made after the swap file was last written.
+    if (!got_int)
+	ml_journal_replay(fname_used, b0_pid, &lnum, &error);
+
     /*
      * Compare the buffer contents with the original file.  When they differ
      * set the 'modified' flag.
@@ -1827,6 +1883,13 @@ theend:
 	if (hp != NULL)
 	    mf_put(mfp, hp, FALSE, FALSE);
 	// PR-3936063: In POSIX preserve mode, delete the file after recovery
+	if (vim_strchr(p_cpo, CPO_PRESERVE) != NULL && mfp->mf_fname != NULL)
+	{
+	    p = ml_journal_name(mfp->mf_fname);
+	    if (p != NULL)
+		mch_remove(p);
+	    vim_free(p);
+	}
 	mf_close(mfp, (vim_strchr(p_cpo, CPO_PRESERVE) != NULL));    // will also vim_free(mfp->mf_fname)
     }
     if (buf != NULL)
@@ -2533,9 +2596,15 @@ ml_sync_all(int check_file, int check_char)
 		need_check_timestamps = TRUE;	// give message later
 	    }
 	}
-	if (buf->b_ml.ml_mfp->mf_dirty == MF_DIRTY_YES)
+	if (ml_journal_sync(buf))
+	    continue;
+	if (buf->b_ml.ml_mfp->mf_dirty == MF_DIRTY_YES
+				       || mf_sync_pending(buf->b_ml.ml_mfp))
 	{
-	    (void)mf_sync(buf->b_ml.ml_mfp, (check_char ? MFS_STOP : 0)
+	    // When waiting for a character write in the background, to avoid
+	    // hanging on a slow file system.
+	    (void)mf_sync(buf->b_ml.ml_mfp,
+				   (check_char ? MFS_STOP | MFS_ASYNC : 0)
 					| (bufIsChanged(buf) ? MFS_FLUSH : 0));
 	    if (check_char && ui_char_avail())	// character available now
 		break;
@@ -2556,8 +2625,6 @@ ml_sync_all(int check_file, int check_char)
     void
 ml_preserve(buf_T *buf, int message)
 {
-    bhdr_T	*hp;
-    linenr_T	lnum;
     memfile_T	*mfp = buf->b_ml.ml_mfp;
     int		status;
     int		got_int_save = got_int;
@@ -2579,44 +2646,16 @@ ml_preserve(buf_T *buf, int message)
 
     ml_flush_line(buf);				    // flush buffered line
     (void)ml_find_line(buf, (linenr_T)0, ML_FLUSH); // flush locked block
+    // this is a checkpoint, the journal must be emptied first
+    if (buf->b_ml.ml_journal != NULL && ml_journal_start(buf) == FAIL)
+	ml_journal_close(buf, TRUE);
     status = mf_sync(mfp, MFS_ALL | MFS_FLUSH);
 
     // stack is invalid after mf_sync(.., MFS_ALL)
     buf->b_ml.ml_stack_top = 0;
 
-    /*
-     * Some of the data blocks may have been changed from negative to
-     * positive block number. In that case the pointer blocks need to be
-     * updated.
-     *
-     * We don't know in which pointer block the references are, so we visit
-     * all data blocks until there are no more translations to be done (or
-     * we hit the end of the file, which can only happen in case a write fails,
-     * e.g. when file system if full).
-     * ml_find_line() does the work by translating the negative block numbers
-     * when getting the first line of each data block.
-     */
-    if (mf_need_trans(mfp) && !got_int)
-    {
-	lnum = 1;
-	while (mf_need_trans(mfp) && lnum <= buf->b_ml.ml_line_count)
-	{
-	    hp = ml_find_line(buf, lnum, ML_FIND);
-	    if (hp == NULL)
-	    {
-		status = FAIL;
-		goto theend;
-	    }
-	    CHECK(buf->b_ml.ml_locked_low != lnum, "low != lnum");
-	    lnum = buf->b_ml.ml_locked_high + 1;
-	}
-	(void)ml_find_line(buf, (linenr_T)0, ML_FLUSH);	// flush locked block
-	// sync the updated pointer blocks
-	if (mf_sync(mfp, MFS_ALL | MFS_FLUSH) == FAIL)
-	    status = FAIL;
-	buf->b_ml.ml_stack_top = 0;	    // stack is invalid now
-    }
-theend:
+    if (ml_update_pointers(buf) == FAIL)
+	status = FAIL;
     got_int |= got_int_save;
 
     if (message)
@@ -2628,6 +2667,396 @@ theend:
     }
 }
 
+/*
+ * Some of the data blocks of "buf" may have been changed from negative to
+ * positive block number.  In that case the pointer blocks need to be updated
+ * and written.
+ *
+ * We don't know in which pointer block the references are, so we visit
+ * all data blocks until there are no more translations to be done (or
+ * we hit the end of the file, which can only happen in case a write fails,
+ * e.g. when file system if full).
+ * ml_find_line() does the work by translating the negative block numbers
+ * when getting the first line of each data block.
+ * Returns FAIL when a block could not be found or written.
+ */
+    static int
+ml_update_pointers(buf_T *buf)
+{
+    bhdr_T	*hp;
+    linenr_T	lnum;
+    memfile_T	*mfp = buf->b_ml.ml_mfp;
+    int		status = OK;
+
+    if (!mf_need_trans(mfp) || got_int)
+	return OK;
+
+    lnum = 1;
+    while (mf_need_trans(mfp) && lnum <= buf->b_ml.ml_line_count)
+    {
+	hp = ml_find_line(buf, lnum, ML_FIND);
+	if (hp == NULL)
+	    return FAIL;
+	CHECK(buf->b_ml.ml_locked_low != lnum, "low != lnum");
+	lnum = buf->b_ml.ml_locked_high + 1;
+    }
+    (void)ml_find_line(buf, (linenr_T)0, ML_FLUSH);	// flush locked block
+    // sync the updated pointer blocks
+    if (mf_sync(mfp, MFS_ALL | MFS_FLUSH) == FAIL)
+	status = FAIL;
+    buf->b_ml.ml_stack_top = 0;	    // stack is invalid now
+    return status;
+}
+
+/*
+ * Functions for the swap file journal.
+ *
+ * When 'swapjournal' is set, a changed buffer does not write its changed
+ * blocks to the swap file every time it is synced.  Instead, the changes are
+ * recorded as small records and appended to a journal file next to the swap
+ * file.  Now and then a checkpoint is done: the journal is emptied and the
+ * changed blocks are written to the swap file.  This happens when the journal
+ * gets big, when the changed blocks use too much memory and for ":preserve".
+ * The changed blocks are kept in memory until then, so that the swap file
+ * always matches the start of the journal.  Recovery reads the swap file and
+ * then applies the changes in the journal.
+ */
+
+/*
+ * Return the name of the journal for swap file "swapname" in allocated
+ * memory.
+ */
+    static char_u *
+ml_journal_name(char_u *swapname)
+{
+    return concat_str(swapname, (char_u *)"j");
+}
+
+/*
+ * Start a new, empty journal for "buf", removing any previous one.  Must be
+ * followed by writing the changed blocks to the swap file.
+ * Returns FAIL when the journal cannot be used, the caller must then use the
+ * swap file as usual.
+ */
+    static int
+ml_journal_start(buf_T *buf)
+{
+    memfile_T	*mfp = buf->b_ml.ml_mfp;
+    mljournal_T	*jp = buf->b_ml.ml_journal;
+    char_u	hdr[JOURNAL_HDR_SIZE];
+
+    if (mfp == NULL || mfp->mf_fd < 0 || mfp->mf_fname == NULL
+#ifdef FEAT_CRYPT
+	    || *buf->b_p_key != NUL
+#endif
+	    )
+	return FAIL;
+
+    if (jp == NULL)
+    {
+	jp = ALLOC_CLEAR_ONE(mljournal_T);
+	if (jp == NULL)
+	    return FAIL;
+	jp->mj_fname = ml_journal_name(mfp->mf_fname);
+	if (jp->mj_fname == NULL)
+	{
+	    vim_free(jp);
+	    return FAIL;
+	}
+	jp->mj_fd = -1;
+	ga_init2(&jp->mj_pending, 1, 4096);
+	buf->b_ml.ml_journal = jp;
+    }
+    else if (jp->mj_fd >= 0)
+	close(jp->mj_fd);
+
+    // The records so far will be in the swap file.
+    jp->mj_pending.ga_len = 0;
+    jp->mj_full = FALSE;
+    jp->mj_fd = mch_open_rw((char *)jp->mj_fname,
+			     O_WRONLY | O_CREAT | O_TRUNC | O_EXTRA | O_NOFOLLOW);
+    if (jp->mj_fd < 0)
+	return FAIL;
+#ifdef HAVE_FD_CLOEXEC
+    {
+	int fdflags = fcntl(jp->mj_fd, F_GETFD);
+	if (fdflags >= 0 && (fdflags & FD_CLOEXEC) == 0)
+	    (void)fcntl(jp->mj_fd, F_SETFD, fdflags | FD_CLOEXEC);
+    }
+#endif
+    mch_memmove(hdr, JOURNAL_MAGIC, STRLEN(JOURNAL_MAGIC));
+    long_to_char(mch_get_pid(), hdr + STRLEN(JOURNAL_MAGIC));
+    if (write_eintr(jp->mj_fd, hdr, JOURNAL_HDR_SIZE) != JOURNAL_HDR_SIZE)
+	return FAIL;
+#ifdef HAVE_FSYNC
+    // An old journal must never be combined with the new swap file contents.
+    if (*p_sws != NUL && vim_fsync(jp->mj_fd) != 0)
+	return FAIL;
+#endif
+    jp->mj_size = JOURNAL_HDR_SIZE;
+    mfp->mf_keep_dirty = TRUE;
+    mfp->mf_need_checkpoint = FALSE;
+    return OK;
+}
+
+/*
+ * Stop using the journal for "buf".  When "del" is TRUE the journal file is
+ * deleted, otherwise changes not written yet are added to it.
+ */
+    void
+ml_journal_close(buf_T *buf, int del)
+{
+    mljournal_T	*jp = buf->b_ml.ml_journal;
+
+    if (jp == NULL)
+	return;
+    if (jp->mj_fd >= 0)
+    {
+	if (!del && !jp->mj_full)
+	    ml_journal_write(buf, TRUE);
+	close(jp->mj_fd);
+    }
+    if (del)
+	mch_remove(jp->mj_fname);
+    vim_free(jp->mj_fname);
+    ga_clear(&jp->mj_pending);
+    VIM_CLEAR(buf->b_ml.ml_journal);
+    if (buf->b_ml.ml_mfp != NULL)
+    {
+	buf->b_ml.ml_mfp->mf_keep_dirty = FALSE;
+	buf->b_ml.ml_mfp->mf_need_checkpoint = FALSE;
+    }
+}
+
+/*
+ * Called by ml_sync_all() for "buf", with the cached line and locked block
+ * flushed.  When 'swapjournal' is set, append the recorded changes to the
+ * journal or do a checkpoint.
+ * Returns TRUE when done, FALSE when the swap file is to be synced as usual.
+ */
+    static int
+ml_journal_sync(buf_T *buf)
+{
+    memfile_T	*mfp = buf->b_ml.ml_mfp;
+    mljournal_T	*jp = buf->b_ml.ml_journal;
+
+    if (!p_swj
+#ifdef FEAT_CRYPT
+	    || *buf->b_p_key != NUL
+#endif
+	    )
+    {
+	ml_journal_close(buf, TRUE);
+	return FALSE;
+    }
+
+    if (jp == NULL)
+    {
+	// The journal is started with the first change.
+	if (!bufIsChanged(buf) || mfp->mf_dirty != MF_DIRTY_YES)
+	    return FALSE;
+    }
+    else if (!jp->mj_full && jp->mj_size < JOURNAL_MAX_SIZE
+				 && mfp->mf_used_count <= mfp->mf_used_count_max)
+    {
+	ml_journal_write(buf, bufIsChanged(buf));
+	return TRUE;
+    }
+
+    // Checkpoint: empty the journal, then write the changed blocks.  If
+    // something fails halfway recovery still works as without a journal.
+    if (ml_journal_start(buf) == FAIL)
+    {
+	ml_journal_close(buf, TRUE);
+	return FALSE;
+    }
+    // The pointer blocks must refer to the data blocks that were written.
+    if (mf_sync(mfp, bufIsChanged(buf) ? MFS_FLUSH : 0) == FAIL
+					   || ml_update_pointers(buf) == FAIL)
+	ml_journal_close(buf, TRUE);
+    else if (mfp->mf_dirty == MF_DIRTY_YES || mf_need_trans(mfp))
+	// interrupted, must not add to the journal until all was written
+	buf->b_ml.ml_journal->mj_full = TRUE;
+    return TRUE;
+}
+
+/*
+ * Append the changes recorded for "buf" to the journal file.  When "flush"
+ * is TRUE make sure they are written to disk.
+ */
+    static void
+ml_journal_write(buf_T *buf, int flush)
+{
+    mljournal_T	*jp = buf->b_ml.ml_journal;
+    long	len = jp->mj_pending.ga_len;
+
+    if (len == 0 || jp->mj_fd < 0)
+	return;
+    if (write_eintr(jp->mj_fd, jp->mj_pending.ga_data, len) != len)
+    {
+	// Probably the disk is full.  A checkpoint will start a new journal.
+	jp->mj_full = TRUE;
+	return;
+    }
+    jp->mj_size += len;
+    jp->mj_pending.ga_len = 0;
+#ifdef HAVE_FSYNC
+    if (flush && *p_sws != NUL)
+	(void)vim_fsync(jp->mj_fd);
+#endif
+}
+
+/*
+ * Record a change of "buf" for the journal.  "op" is JOURNAL_APPEND,
+ * JOURNAL_DELETE or JOURNAL_REPLACE.  "text" is the text of the line, "len"
+ * its length without the NUL.
+ */
+    static void
+ml_journal_add(
+    buf_T	*buf,
+    int		op,
+    linenr_T	lnum,
+    char_u	*text,
+    int		len)
+{
+    mljournal_T	*jp = buf->b_ml.ml_journal;
+    char_u	*p;
+
+    if (jp == NULL || jp->mj_full)
+	return;
+    if (jp->mj_pending.ga_len + len + JOURNAL_REC_SIZE > JOURNAL_MAX_SIZE
+		   || ga_grow(&jp->mj_pending, len + JOURNAL_REC_SIZE) == FAIL)
+    {
+	// Too many changes, writing the swap file is cheaper.
+	jp->mj_full = TRUE;
+	ga_clear(&jp->mj_pending);
+	return;
+    }
+    p = (char_u *)jp->mj_pending.ga_data + jp->mj_pending.ga_len;
+    p[0] = op;
+    long_to_char((long)lnum, p + 1);
+    long_to_char((long)len, p + 5);
+    mch_memmove(p + JOURNAL_REC_SIZE, text, (size_t)len);
+    jp->mj_pending.ga_len += JOURNAL_REC_SIZE + len;
+}
+
+/*
+ * Do a checkpoint for "buf" when changed blocks could not be released because
+ * they are kept for the journal.  Otherwise memory use keeps growing until
+ * the next time the swap file is synced.
+ * Only to be called when the text is consistent, the cached line and the
+ * locked block are flushed.
+ */
+    static void
+ml_journal_check(buf_T *buf)
+{
+    memfile_T	*mfp = buf->b_ml.ml_mfp;
+
+    if (buf->b_ml.ml_journal == NULL || mfp == NULL
+			    || !mfp->mf_need_checkpoint || mfp->mf_pin_count > 0)
+	return;
+    ml_preserve(buf, FALSE);
+    // When the checkpoint failed the journal was closed, don't try again.
+    mfp->mf_need_checkpoint = FALSE;
+}
+
+/*
+ * Apply the changes in the journal of swap file "swapname" to the lines
+ * recovered from that swap file, lines 1 to "*lnump" of the current buffer.
+ * "pid" is the process ID from block 0 of the swap file, the journal must
+ * have been written by that process.
+ * "*lnump" is adjusted for added and deleted lines.  "*errorp" is
+ * incremented when the journal does not match the text.
+ */
+    static void
+ml_journal_replay(
+    char_u	*swapname,
+    long	pid,
+    linenr_T	*lnump,
+    long	*errorp)
+{
+    char_u	*fname;
+    int		fd;
+    stat_T	st;
+    char_u	*data = NULL;
+    char_u	*p;
+    char_u	*end;
+    char_u	*text;
+    linenr_T	lnum;
+    long	len;
+    long	count = 0;
+    int		op;
+
+    if (swapname == NULL || (fname = ml_journal_name(swapname)) == NULL)
+	return;
+    fd = mch_open((char *)fname, O_RDONLY | O_EXTRA, 0);
+    if (fd < 0)
+	goto theend;
+    if (mch_fstat(fd, &st) < 0 || st.st_size < JOURNAL_HDR_SIZE
+	    || (data = alloc(st.st_size)) == NULL
+	    || read_eintr(fd, data, st.st_size) != st.st_size
+	    || STRNCMP(data, JOURNAL_MAGIC, STRLEN(JOURNAL_MAGIC)) != 0
+	    || char_to_long(data + STRLEN(JOURNAL_MAGIC)) != pid)
+    {
+	close(fd);
+	goto theend;
+    }
+    close(fd);
+
+    end = data + st.st_size;
+    for (p = data + JOURNAL_HDR_SIZE; end - p >= JOURNAL_REC_SIZE;
+						 p += JOURNAL_REC_SIZE + len)
+    {
+	op = *p;
+	lnum = char_to_long(p + 1);
+	len = char_to_long(p + 5);
+	// A record that was not completely written is ignored.
+	if ((op != JOURNAL_APPEND && op != JOURNAL_DELETE
+						   && op != JOURNAL_REPLACE)
+		|| len < 0 || end - p - JOURNAL_REC_SIZE < len)
+	    break;
+	if (lnum < (op == JOURNAL_APPEND ? 0 : 1) || lnum > *lnump)
+	{
+	    ++*errorp;
+	    ml_append(*lnump, (char_u *)_("???JOURNAL DOES NOT MATCH"),
+							    (colnr_T)0, TRUE);
+	    ++*lnump;
+	    break;
+	}
+	text = vim_strnsave(p + JOURNAL_REC_SIZE, len);
+	if (text == NULL)
+	    break;
+	if (op == JOURNAL_APPEND)
+	{
+	    ml_append(lnum, text, (colnr_T)0, FALSE);
+	    ++*lnump;
+	}
+	else if (op == JOURNAL_DELETE && *lnump > 1)
+	{
+	    ml_delete(lnum);
+	    --*lnump;
+	}
+	else if (op == JOURNAL_DELETE)
+	    // deleting the only line leaves an empty line
+	    ml_replace(lnum, (char_u *)"", TRUE);
+	else
+	{
+	    ml_replace(lnum, text, FALSE);
+	    text = NULL;
+	}
+	vim_free(text);
+	++count;
+    }
+    if (count > 0)
+	smsg(NGETTEXT("Applied %ld change from journal \"%s\"",
+		    "Applied %ld changes from journal \"%s\"", count),
+							       count, fname);
+
+theend:
+    vim_free(data);
+    vim_free(fname);
+}
+
 /*
  * NOTE: The pointer returned by the ml_get_*() functions only remains valid
  * until the next call!
@@ -2864,6 +3293,98 @@ ml_line_alloced(void)
     return (curbuf->b_ml.ml_flags & ML_LINE_DIRTY);
 }
 
+/*
+ * Get line "lnum" in buffer "buf" and pin it, so that the text remains valid
+ * when other lines are obtained with ml_get_buf().  No copy is made, the
+ * returned pointer points into the data block, which is not released from
+ * memory until ml_unpin_line() is called.  The buffer must not be changed
+ * while the line is pinned.
+ * When "lenp" is not NULL "*lenp" is set to the length of the text.
+ * Every call must be followed by a call to ml_unpin_line().
+ */
+    char_u *
+ml_pin_line(buf_T *buf, linenr_T lnum, colnr_T *lenp)
+{
+    char_u	*line;
+
+    // A changed line is kept in allocated memory, put it in its block.
+    if (buf->b_ml.ml_flags & ML_LINE_DIRTY)
+	ml_flush_line(buf);
+
+    line = ml_get_buf(buf, lnum, FALSE);
+    if (buf->b_ml.ml_mfp != NULL)
+    {
+	++buf->b_ml.ml_mfp->mf_pin_count;
+#ifdef FEAT_EVAL
+	if ((buf->b_ml.ml_flags & ML_ALLOCATED)
+		&& buf->b_ml.ml_locked != NULL
+		&& lnum >= buf->b_ml.ml_locked_low
+		&& lnum <= buf->b_ml.ml_locked_high)
+	{
+	    DATA_BL	*dp = (DATA_BL *)(buf->b_ml.ml_locked->bh_data);
+
+	    // With test_override('alloc_lines') the copy would be freed when
+	    // getting another line, use the text in the data block.
+	    line = (char_u *)dp + (dp->db_index[lnum - buf->b_ml.ml_locked_low]
+							      & DB_INDEX_MASK);
+	}
+#endif
+    }
+
+    if (lenp != NULL)
+    {
+	if (buf->b_ml.ml_line_textlen <= 0)
+	    buf->b_ml.ml_line_textlen = (int)STRLEN(line) + 1;
+	*lenp = buf->b_ml.ml_line_textlen - 1;
+    }
+    return line;
+}
+
+/*
+ * Like ml_pin_line(), but get the text of line "lnum" and the lines after it
+ * that are in the same data block, up to line "lnum_end" and at most
+ * "maxcount" lines.  The pointers are stored in "lines[]".
+ * Returns the number of lines.  ml_unpin_line() must be called once when
+ * done with the text.
+ */
+    int
+ml_pin_lines(
+    buf_T	*buf,
+    linenr_T	lnum,
+    linenr_T	lnum_end,
+    char_u	**lines,
+    int		maxcount)
+{
+    DATA_BL	*dp;
+    int		count = 1;
+
+    lines[0] = ml_pin_line(buf, lnum, NULL);
+    if (buf->b_ml.ml_locked == NULL || lnum < buf->b_ml.ml_locked_low
+					     || lnum > buf->b_ml.ml_locked_high)
+	return count;
+
+    dp = (DATA_BL *)(buf->b_ml.ml_locked->bh_data);
+    while (count < maxcount && lnum + count <= lnum_end
+				 && lnum + count <= buf->b_ml.ml_locked_high)
+    {
+	lines[count] = (char_u *)dp + (dp->db_index[lnum + count
+				   - buf->b_ml.ml_locked_low] & DB_INDEX_MASK);
+	++count;
+    }
+    return count;
+}
+
+/*
+ * Undo one ml_pin_line() for buffer "buf".  Blocks can be released again when
+ * no line is pinned.
+ */
+    void
+ml_unpin_line(buf_T *buf)
+{
+    if (buf->b_ml.ml_mfp != NULL && buf->b_ml.ml_mfp->mf_pin_count > 0)
+	--buf->b_ml.ml_mfp->mf_pin_count;
+}
+
 #ifdef FEAT_PROP_POPUP
 /*
  * Add text properties that continue from the previous line.
@@ -2929,6 +3450,69 @@ add_text_props_for_append(
 }
 #endif
 
+/*
+ * Insert line "line" of "len" bytes, including the NUL, after index "db_idx"
+ * (can be -1) in data block "dp", which is locked in "buf" and must have
+ * enough room.  "line_count" is the number of lines in the block before the
+ * insertion.
+ */
+    static void
+ml_insert_in_block(
+    buf_T	*buf,
+    DATA_BL	*dp,
+    int		db_idx,
+    int		line_count,
+    char_u	*line,
+    colnr_T	len,
+    int		flags)		// ML_APPEND_ flags
+{
+    int		offset;
+    int		i;
+
+    dp->db_txt_start -= len;
+    dp->db_free -= len + INDEX_SIZE;
+    ++(dp->db_line_count);
+
+    /*
+     * move the text of the lines that follow to the front
+     * adjust the indexes of the lines that follow
+     */
+    if (line_count > db_idx + 1)	    // if there are following lines
+    {
+	/*
+	 * Offset is the start of the previous line.
+	 * This will become the character just after the new line.
+	 */
+	if (db_idx < 0)
+	    offset = dp->db_txt_end;
+	else
+	    offset = ((dp->db_index[db_idx]) & DB_INDEX_MASK);
+	mch_memmove((char *)dp + dp->db_txt_start,
+				      (char *)dp + dp->db_txt_start + len,
+			     (size_t)(offset - (dp->db_txt_start + len)));
+	for (i = line_count - 1; i > db_idx; --i)
+	    dp->db_index[i + 1] = dp->db_index[i] - len;
+	dp->db_index[db_idx + 1] = offset - len;
+    }
+    else
+	// add line at the end (which is the start of the text)
+	dp->db_index[db_idx + 1] = dp->db_txt_start;
+
+    /*
+     * copy the text into the block
+     */
+    mch_memmove((char *)dp + dp->db_index[db_idx + 1], line, (size_t)len);
+    if (flags & ML_APPEND_MARK)
+	dp->db_index[db_idx + 1] |= DB_MARKED;
+
+    /*
+     * Mark the block dirty.
+     */
+    buf->b_ml.ml_flags |= ML_LOCKED_DIRTY;
+    if (!(flags & ML_APPEND_NEW))
+	buf->b_ml.ml_flags |= ML_LOCKED_POS;
+}
+
     static int
 ml_append_int(
     buf_T	*buf,
@@ -3045,52 +3629,9 @@ ml_append_int(
 
     if ((int)dp->db_free >= space_needed)	// enough room in data block
     {
-	/*
-	 * Insert the new line in an existing data block, or in the data block
-	 * allocated above.
-	 */
-	dp->db_txt_start -= len;
-	dp->db_free -= space_needed;
-	++(dp->db_line_count);
-
-	/*
-	 * move the text of the lines that follow to the front
-	 * adjust the indexes of the lines that follow
-	 */
-	if (line_count > db_idx + 1)	    // if there are following lines
-	{
-	    /*
-	     * Offset is the start of the previous line.
-	     * This will become the character just after the new line.
-	     */
-	    if (db_idx < 0)
-		offset = dp->db_txt_end;
-	    else
-		offset = ((dp->db_index[db_idx]) & DB_INDEX_MASK);
-	    mch_memmove((char *)dp + dp->db_txt_start,
-					  (char *)dp + dp->db_txt_start + len,
-				 (size_t)(offset - (dp->db_txt_start + len)));
-	    for (i = line_count - 1; i > db_idx; --i)
-		dp->db_index[i + 1] = dp->db_index[i] - len;
-	    dp->db_index[db_idx + 1] = offset - len;
-	}
-	else
-	    // add line at the end (which is the start of the text)
-	    dp->db_index[db_idx + 1] = dp->db_txt_start;
-
-	/*
-	 * copy the text into the block
-	 */
-	mch_memmove((char *)dp + dp->db_index[db_idx + 1], line, (size_t)len);
-	if (flags & ML_APPEND_MARK)
-	    dp->db_index[db_idx + 1] |= DB_MARKED;
-
-	/*
-	 * Mark the block dirty.
-	 */
-	buf->b_ml.ml_flags |= ML_LOCKED_DIRTY;
-	if (!(flags & ML_APPEND_NEW))
-	    buf->b_ml.ml_flags |= ML_LOCKED_POS;
+	// Insert the new line in an existing data block, or in the data block
+	// allocated above.
+	ml_insert_in_block(buf, dp, db_idx, line_count, line, len, flags);
     }
     else	    // not enough space in data block
     {
@@ -3496,7 +4037,14 @@ ml_append_flush(
 	ml_flush_line(buf);
 #endif
 
-    return ml_append_int(buf, lnum, line, len, flags);
+    if (ml_append_int(buf, lnum, line, len, flags) == FAIL)
+	return FAIL;
+    if (buf->b_ml.ml_journal != NULL)
+    {
+	ml_journal_add(buf, JOURNAL_APPEND, lnum, line, (int)STRLEN(line));
+	ml_journal_check(buf);
+    }
+    return OK;
 }
 
 /*
@@ -3534,6 +4082,94 @@ ml_append_flags(
     return ml_append_flush(curbuf, lnum, line, len, flags);
 }
 
+/*
+ * Append "count" lines from "lines" after line "lnum" in the current buffer.
+ * Does the same as calling ml_append_flags() for each line, but faster: while
+ * the lines fit in the locked data block they are copied into it directly,
+ * without finding the block again for every line.
+ * Check: The caller of this function should probably also call
+ * appended_lines_mark().
+ *
+ * return FAIL for failure, OK otherwise
+ */
+    int
+ml_append_lines(
+    linenr_T	lnum,		// append after this line (can be 0)
+    char_u	**lines,	// text of the new lines
+    long	count,		// number of lines in "lines"
+    int		flags)		// ML_APPEND_ values
+{
+    buf_T	*buf = curbuf;
+    long	i;
+    colnr_T	len;
+    int		space_needed;	// space needed for new line
+    int		simple;
+    bhdr_T	*hp;
+    DATA_BL	*dp;
+
+    // When starting up, we might still need to create the memfile
+    if (buf->b_ml.ml_mfp == NULL && open_buffer(FALSE, NULL, 0) == FAIL)
+	return FAIL;
+    if (lnum > buf->b_ml.ml_line_count)
+	return FAIL;  // lnum out of range
+    if (count <= 0)
+	return OK;
+
+    if (buf->b_ml.ml_line_lnum != 0)
+	ml_flush_line(buf);
+#ifdef FEAT_EVAL
+    may_invoke_listeners(buf, lnum + 1, lnum + 1, count);
+    if (buf->b_ml.ml_line_lnum != 0)
+	ml_flush_line(buf);
+#endif
+
+    // Text properties and netbeans need to handle every line, then always
+    // use ml_append_int().
+    simple = !mf_dont_release
+#ifdef FEAT_PROP_POPUP
+	&& !buf->b_has_textprop
+#endif
+#ifdef FEAT_NETBEANS_INTG
+	&& !netbeans_active()
+#endif
+#ifdef FEAT_JOB_CHANNEL
+	&& !buf->b_write_to_channel
+#endif
+	;
+
+    for (i = 0; i < count; ++i, ++lnum)
+    {
+	len = (colnr_T)STRLEN(lines[i]) + 1;
+	space_needed = len + INDEX_SIZE;	// space needed for text + index
+	hp = buf->b_ml.ml_locked;
+	if (simple && hp != NULL && lnum >= buf->b_ml.ml_locked_low
+		&& lnum <= buf->b_ml.ml_locked_high
+		&& (dp = (DATA_BL *)(hp->bh_data))->db_line_count
+		      == buf->b_ml.ml_locked_high - buf->b_ml.ml_locked_low + 1
+		&& (int)dp->db_free >= space_needed)
+	{
+	    // This is what ml_append_int() does when the line fits in the
+	    // locked block.
+	    if (lowest_marked && lowest_marked > lnum)
+		lowest_marked = lnum + 1;
+	    ml_insert_in_block(buf, dp, lnum - buf->b_ml.ml_locked_low,
+				    dp->db_line_count, lines[i], len, flags);
+	    ++buf->b_ml.ml_locked_lineadd;
+	    ++buf->b_ml.ml_locked_high;
+	    ++buf->b_ml.ml_line_count;
+	    buf->b_ml.ml_flags &= ~ML_EMPTY;
+#ifdef FEAT_BYTEOFF
+	    ml_updatechunk(buf, lnum + 1, (long)len, ML_CHNK_ADDLINE);
+#endif
+	}
+	else if (ml_append_int(buf, lnum, lines[i], len, flags) == FAIL)
+	    return FAIL;
+	ml_journal_add(buf, JOURNAL_APPEND, lnum, lines[i], len - 1);
+	ml_journal_check(buf);
+    }
+    return OK;
+}
+
 
 #if defined(FEAT_SPELL) || defined(FEAT_QUICKFIX) || defined(FEAT_PROP_POPUP) \
 	|| defined(PROTO)
@@ -3618,6 +4254,9 @@ ml_replace_len(
 	if (line == NULL)
 	    return FAIL;
     }
+    // A changed line is flushed when getting another line, this is the first
+    // chance to do a checkpoint after that.
+    ml_journal_check(curbuf);
 
 #ifdef FEAT_NETBEANS_INTG
     if (netbeans_active())
@@ -4005,7 +4644,11 @@ ml_delete_flags(linenr_T lnum, int flags)
     may_invoke_listeners(curbuf, lnum, lnum + 1, -1);
 #endif
 
-    return ml_delete_int(curbuf, lnum, flags);
+    if (ml_delete_int(curbuf, lnum, flags) == FAIL)
+	return FAIL;
+    ml_journal_add(curbuf, JOURNAL_DELETE, lnum, NULL, 0);
+    ml_journal_check(curbuf);
+    return OK;
 }
 
 /*
@@ -4155,6 +4798,9 @@ ml_flush_line(buf_T *buf)
 
 	lnum = buf->b_ml.ml_line_lnum;
 	new_line = buf->b_ml.ml_line_ptr;
+	if (buf->b_ml.ml_journal != NULL)
+	    ml_journal_add(buf, JOURNAL_REPLACE, lnum, new_line,
+						       (int)STRLEN(new_line));
 
 	hp = ml_find_line(buf, lnum, ML_FIND);
 	if (hp == NULL)
@@ -5292,6 +5938,13 @@ findswapname(
 			    break;
 			case SEA_CHOICE_DELETE:
 			    mch_remove(fname);
+			    {
+				char_u *jname = ml_journal_name(fname);
+
+				if (jname != NULL)
+				    mch_remove(jname);
+				vim_free(jname);
+			    }
 			    break;
 			case SEA_CHOICE_QUIT:
 			    swap_exists_action = SEA_QUIT;
@@ -5683,6 +6336,119 @@ ml_crypt_prepare(memfile_T *mfp, off_T offset, int reading)
 #define MLCS_MAXL 800	// max no of lines in chunk
 #define MLCS_MINL 400   // should be half of MLCS_MAXL
 
+/*
+ * The chunks are also kept in a Fenwick tree (binary indexed tree), so that
+ * the chunk holding a line or byte offset is found in O(log n) time.
+ * ml_chunktree[i] holds the sums of the lines and sizes of the chunks
+ * i - (i & -i) to i - 1, index zero is not used.  Changing the size of a
+ * chunk updates the tree.  When chunks are split or joined the tree is freed
+ * and built again when it is needed.
+ */
+
+/*
+ * Build the chunk tree for "buf" if there isn't one.
+ * Return FAIL when out of memory.
+ */
+    static int
+ml_chunktree_build(buf_T *buf)
+{
+    chunksize_T	*tree;
+    int		n = buf->b_ml.ml_usedchunks;
+    int		i;
+    int		j;
+
+    if (buf->b_ml.ml_chunktree != NULL)
+	return OK;
+    tree = ALLOC_MULT(chunksize_T, buf->b_ml.ml_numchunks + 1);
+    if (tree == NULL)
+	return FAIL;
+    for (i = 1; i <= n; ++i)
+	tree[i] = buf->b_ml.ml_chunksize[i - 1];
+    for (i = 1; i <= n; ++i)
+    {
+	j = i + (i & -i);
+	if (j <= n)
+	{
+	    tree[j].mlcs_numlines += tree[i].mlcs_numlines;
+	    tree[j].mlcs_totalsize += tree[i].mlcs_totalsize;
+	}
+    }
+    buf->b_ml.ml_chunktree = tree;
+    return OK;
+}
+
+/*
+ * Add "lines" and "size" to chunk "idx" in the chunk tree, if there is one.
+ */
+    static void
+ml_chunktree_add(buf_T *buf, int idx, int lines, long size)
+{
+    chunksize_T	*tree = buf->b_ml.ml_chunktree;
+    int		i;
+
+    if (tree == NULL)
+	return;
+    for (i = idx + 1; i <= buf->b_ml.ml_usedchunks; i += i & -i)
+    {
+	tree[i].mlcs_numlines += lines;
+	tree[i].mlcs_totalsize += size;
+    }
+}
+
+/*
+ * Find the chunk that contains line "lnum", or when "lnum" is zero, the byte
+ * at "offset".  When "ffdos" is TRUE a CR is counted for each line.
+ * Sets "*linep" to the first line in the chunk and "*sizep" to the number of
+ * bytes before it.  When beyond the end the last chunk is used.
+ * The chunk tree must have been built.
+ * Returns the index of the chunk.
+ */
+    static int
+ml_chunktree_find(
+    buf_T	*buf,
+    linenr_T	lnum,
+    long	offset,
+    int		ffdos,
+    linenr_T	*linep,
+    long	*sizep)
+{
+    chunksize_T	*tree = buf->b_ml.ml_chunktree;
+    chunksize_T	*cp;
+    int		n = buf->b_ml.ml_usedchunks;
+    int		idx = 0;
+    int		step;
+    linenr_T	lines = 0;
+    long	size = 0;
+
+    for (step = 1; step * 2 <= n; step *= 2)
+	;
+    for ( ; step > 0; step /= 2)
+    {
+	if (idx + step > n)
+	    continue;
+	cp = tree + idx + step;
+	if (lnum != 0 ? lines + cp->mlcs_numlines < lnum
+		      : size + cp->mlcs_totalsize
+				   + (long)ffdos * cp->mlcs_numlines < offset)
+	{
+	    // all lines in these chunks are before the one we look for
+	    idx += step;
+	    lines += cp->mlcs_numlines;
+	    size += cp->mlcs_totalsize + (long)ffdos * cp->mlcs_numlines;
+	}
+    }
+    if (idx == n && n > 0)
+    {
+	// Last chunk is special because it will never qualify.
+	cp = buf->b_ml.ml_chunksize + --idx;
+	lines -= cp->mlcs_numlines;
+	size -= cp->mlcs_totalsize + (long)ffdos * cp->mlcs_numlines;
+    }
+    *linep = lines + 1;
+    *sizep = size;
+    return idx;
+}
+
 /*
  * Keep information for finding byte offset of a line, updtype may be one of:
  * ML_CHNK_ADDLINE: Add len to parent chunk, possibly splitting it
@@ -5734,6 +6500,7 @@ ml_updatechunk(
 	buf->b_ml.ml_usedchunks = 1;
 	buf->b_ml.ml_chunksize[0].mlcs_numlines = 1;
 	buf->b_ml.ml_chunksize[0].mlcs_totalsize = (long)buf->b_ml.ml_line_len;
+	VIM_CLEAR(buf->b_ml.ml_chunktree);
 	return;
     }
 
@@ -5744,11 +6511,12 @@ ml_updatechunk(
     if (buf != ml_upd_lastbuf || line != ml_upd_lastline + 1
 	    || updtype != ML_CHNK_ADDLINE)
     {
-	for (curline = 1, curix = 0;
-	     curix < buf->b_ml.ml_usedchunks - 1
-	     && line >= curline + buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-	     curix++)
-	    curline += buf->b_ml.ml_chunksize[curix].mlcs_numlines;
+	if (ml_chunktree_build(buf) == FAIL)
+	{
+	    buf->b_ml.ml_usedchunks = -1;
+	    return;
+	}
+	curix = ml_chunktree_find(buf, line, 0L, FALSE, &curline, &size);
     }
     else if (curix < buf->b_ml.ml_usedchunks - 1
 	      && line >= curline + buf->b_ml.ml_chunksize[curix].mlcs_numlines)
@@ -5765,12 +6533,14 @@ ml_updatechunk(
     if (updtype == ML_CHNK_ADDLINE)
     {
 	curchnk->mlcs_numlines++;
+	ml_chunktree_add(buf, curix, 1, len);
 
 	// May resize here so we don't have to do it in both cases below
 	if (buf->b_ml.ml_usedchunks + 1 >= buf->b_ml.ml_numchunks)
 	{
 	    chunksize_T *t_chunksize = buf->b_ml.ml_chunksize;
 
+	    VIM_CLEAR(buf->b_ml.ml_chunktree);
 	    buf->b_ml.ml_numchunks = buf->b_ml.ml_numchunks * 3 / 2;
 	    buf->b_ml.ml_chunksize = vim_realloc(buf->b_ml.ml_chunksize,
 			    sizeof(chunksize_T) * buf->b_ml.ml_numchunks);
@@ -5791,6 +6561,7 @@ ml_updatechunk(
 	    int	    text_end;
 	    int	    linecnt;
 
+	    VIM_CLEAR(buf->b_ml.ml_chunktree);
 	    mch_memmove(buf->b_ml.ml_chunksize + curix + 1,
 			buf->b_ml.ml_chunksize + curix,
 			(buf->b_ml.ml_usedchunks - curix) *
@@ -5863,6 +6634,7 @@ ml_updatechunk(
 	     * We are in the last chunk and it is cheap to create a new one
 	     * after this. Do it now to avoid the loop above later on
 	     */
+	    VIM_CLEAR(buf->b_ml.ml_chunktree);
 	    curchnk = buf->b_ml.ml_chunksize + curix + 1;
 	    buf->b_ml.ml_usedchunks++;
 	    if (line == buf->b_ml.ml_line_count)
@@ -5899,6 +6671,7 @@ ml_updatechunk(
     else if (updtype == ML_CHNK_DELLINE)
     {
 	curchnk->mlcs_numlines--;
+	ml_chunktree_add(buf, curix, -1, len);
 	ml_upd_lastbuf = NULL;   // Force recalc of curix & curline
 	if (curix < buf->b_ml.ml_usedchunks - 1
 		&& curchnk->mlcs_numlines + curchnk[1].mlcs_numlines
@@ -5909,6 +6682,7 @@ ml_updatechunk(
 	}
 	else if (curix == 0 && curchnk->mlcs_numlines <= 0)
 	{
+	    VIM_CLEAR(buf->b_ml.ml_chunktree);
 	    buf->b_ml.ml_usedchunks--;
 	    mch_memmove(buf->b_ml.ml_chunksize, buf->b_ml.ml_chunksize + 1,
 			buf->b_ml.ml_usedchunks * sizeof(chunksize_T));
@@ -5922,6 +6696,7 @@ ml_updatechunk(
 	}
 
 	// Collapse chunks
+	VIM_CLEAR(buf->b_ml.ml_chunktree);
 	curchnk[-1].mlcs_numlines += curchnk->mlcs_numlines;
 	curchnk[-1].mlcs_totalsize += curchnk->mlcs_totalsize;
 	buf->b_ml.ml_usedchunks--;
@@ -5932,6 +6707,8 @@ ml_updatechunk(
 			sizeof(chunksize_T));
 	return;
     }
+    else
+	ml_chunktree_add(buf, curix, 0, len);
     ml_upd_lastbuf = buf;
     ml_upd_lastline = line;
     ml_upd_lastcurline = curline;
@@ -5948,7 +6725,6 @@ ml_updatechunk(
 ml_find_line_or_offset(buf_T *buf, linenr_T lnum, long *offp)
 {
     linenr_T	curline;
-    int		curix;
     long	size;
     bhdr_T	*hp;
     DATA_BL	*dp;
@@ -5976,24 +6752,12 @@ ml_find_line_or_offset(buf_T *buf, linenr_T lnum, long *offp)
     if (lnum == 0 && offset <= 0)
 	return 1;   // Not a "find offset" and offset 0 _must_ be in line 1
     /*
-     * Find the last chunk before the one containing our line. Last chunk is
-     * special because it will never qualify.
+     * Find the chunk containing our line or offset.
      */
-    curline = 1;
-    curix = size = 0;
-    while (curix < buf->b_ml.ml_usedchunks - 1
-	    && ((lnum != 0
-	     && lnum >= curline + buf->b_ml.ml_chunksize[curix].mlcs_numlines)
-		|| (offset != 0
-	       && offset > size + buf->b_ml.ml_chunksize[curix].mlcs_totalsize
-		 + (long)ffdos * buf->b_ml.ml_chunksize[curix].mlcs_numlines)))
-    {
-	curline += buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-	size += buf->b_ml.ml_chunksize[curix].mlcs_totalsize;
-	if (offset && ffdos)
-	    size += buf->b_ml.ml_chunksize[curix].mlcs_numlines;
-	curix++;
-    }
+    if (ml_chunktree_build(buf) == FAIL)
+	return -1;
+    (void)ml_chunktree_find(buf, lnum, offset, offset != 0 && ffdos,
+							       &curline, &size);
 
     while ((lnum != 0 && curline < lnum) || (offset != 0 && size < offset))
     {
@@ -986,6 +986,7 @@ EXTERN char_u	*p_sps;		// 'spellsuggest'
 EXTERN int	p_spr;		// 'splitright'
 EXTERN int	p_sol;		// 'startofline'
 EXTERN char_u	*p_su;		// 'suffixes'
+EXTERN int	p_swj;		// 'swapjournal'
 EXTERN char_u	*p_sws;		// 'swapsync'
 EXTERN char_u	*p_swb;		// 'switchbuf'
 EXTERN unsigned	swb_flags;
@@ -1,5 +1,6 @@
 /* memfile.c */
 memfile_T *mf_open(char_u *fname, int flags);
+void mf_size_hint(memfile_T *mfp, off_T size);
 int mf_open_file(memfile_T *mfp, char_u *fname);
 void mf_close(memfile_T *mfp, int del_file);
 void mf_close_file(buf_T *buf, int getlines);
@@ -9,6 +10,8 @@ bhdr_T *mf_get(memfile_T *mfp, blocknr_T nr, int page_count);
 void mf_put(memfile_T *mfp, bhdr_T *hp, int dirty, int infile);
 void mf_free(memfile_T *mfp, bhdr_T *hp);
 int mf_sync(memfile_T *mfp, int flags);
+void mf_sync_wait(memfile_T *mfp);
+int mf_sync_pending(memfile_T *mfp);
 void mf_set_dirty(memfile_T *mfp);
 int mf_release_all(void);
 blocknr_T mf_trans_del(memfile_T *mfp, blocknr_T old_nr);
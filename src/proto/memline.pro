@@ -15,6 +15,7 @@ char_u *make_percent_swname(char_u *dir, char_u *dir_end, char_u *name);
 void get_b0_dict(char_u *fname, dict_T *d);
 void ml_sync_all(int check_file, int check_char);
 void ml_preserve(buf_T *buf, int message);
+void ml_journal_close(buf_T *buf, int del);
 char_u *ml_get(linenr_T lnum);
 char_u *ml_get_pos(pos_T *pos);
 char_u *ml_get_curline(void);
@@ -26,8 +27,12 @@ colnr_T ml_get_cursor_len(void);
 colnr_T ml_get_buf_len(buf_T *buf, linenr_T lnum);
 char_u *ml_get_buf(buf_T *buf, linenr_T lnum, int will_change);
 int ml_line_alloced(void);
+char_u *ml_pin_line(buf_T *buf, linenr_T lnum, colnr_T *lenp);
+int ml_pin_lines(buf_T *buf, linenr_T lnum, linenr_T lnum_end, char_u **lines, int maxcount);
+void ml_unpin_line(buf_T *buf);
 int ml_append(linenr_T lnum, char_u *line, colnr_T len, int newfile);
 int ml_append_flags(linenr_T lnum, char_u *line, colnr_T len, int flags);
+int ml_append_lines(linenr_T lnum, char_u **lines, long count, int flags);
 int ml_append_buf(buf_T *buf, linenr_T lnum, char_u *line, colnr_T len, int newfile);
 int ml_replace(linenr_T lnum, char_u *line, int copy);
 int ml_replace_len(linenr_T lnum, char_u *line_arg, colnr_T len_arg, int has_props, int copy);
@@ -1,7 +1,12 @@
 /* syntax.c */
 void syntax_start(win_T *wp, linenr_T lnum);
+int syntax_idle_pending(void);
+void syntax_idle_parse(void);
 void syn_stack_free_all(synblock_T *block);
 void syn_stack_apply_changes(buf_T *buf);
+char_u *syn_stack_get_cache(buf_T *buf, size_t *lenp);
+void syn_stack_set_cache(buf_T *buf, char_u *data, size_t len);
+void syn_stack_free_cache(synblock_T *block);
 void syntax_end_parsing(win_T *wp, linenr_T lnum);
 int syntax_check_changed(linenr_T lnum);
 int get_syntax_attr(colnr_T col, int *can_spell, int keep_state);
@@ -6437,6 +6437,12 @@ vgr_match_buflines(
 	col = 0;
 	if (!(flags & VGR_FUZZY))
 	{
+	    // Skip over lines that cannot match.
+	    lnum = vim_regexec_multi_skip(regmatch, curwin, buf, lnum,
+						     buf->b_ml.ml_line_count);
+	    if (lnum > buf->b_ml.ml_line_count)
+		break;
+
 	    // Regular expression match
 	    while (vim_regexec_multi(regmatch, curwin, buf, lnum,
 								col, NULL) > 0)
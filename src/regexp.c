@@ -349,6 +349,7 @@ init_class_tab(void)
 #define RF_HASNL    4	// can match a NL
 #define RF_ICOMBINE 8	// ignore combining characters
 #define RF_LOOKBH   16	// uses "\@<=" or "\@<!"
+#define RF_ZSTART   32	// uses "\zs"
 
 /*
  * Global work variables for vim_regcomp().
@@ -436,6 +437,7 @@ static int	cstrncmp(char_u *s1, char_u *s2, int *n);
 static char_u	*cstrchr(char_u *, int);
 static int	re_mult_next(char *what);
 static int	reg_iswordc(int);
+static regprog_T *regcomp_uncached(char_u *expr_arg, int re_flags);
 #ifdef FEAT_EVAL
 static void report_re_switch(char_u *pat);
 #endif
@@ -452,6 +454,16 @@ re_multiline(regprog_T *prog)
     return (prog->regflags & RF_HASNL);
 }
 
+/*
+ * Return TRUE if compiled regular expression "prog" uses "\zs", thus the
+ * match may start after the position where it was found.
+ */
+    int
+re_has_zstart(regprog_T *prog)
+{
+    return (prog->regflags & RF_ZSTART);
+}
+
 /*
  * Check for an equivalence class name "[=a=]".  "pp" points to the '['.
  * Returns a character representing the class. Zero means that no item was
@@ -1124,14 +1136,6 @@ static void	cleanup_zsubexpr(void);
 #endif
 static int	match_with_backref(linenr_T start_lnum, colnr_T start_col, linenr_T end_lnum, colnr_T end_col, int *bytelen);
 
-/*
- * Sometimes need to save a copy of a line.  Since alloc()/free() is very
- * slow, we keep one allocated piece of memory and only re-allocate it when
- * it's too small.  It's freed in bt_regexec_both() when finished.
- */
-static char_u	*reg_tofree = NULL;
-static unsigned	reg_tofreelen;
-
 /*
  * Structure used to store the execution state of the regex engine.
  * Which ones are set depends on whether a single-line or multi-line match is
@@ -1583,30 +1587,26 @@ match_with_backref(
     colnr_T	ccol = start_col;
     int		len;
     char_u	*p;
+    int		pinned;
+    int		retval = RA_MATCH;
 
     if (bytelen != NULL)
 	*bytelen = 0;
-    for (;;)
+
+    // Getting one line may invalidate the other.  Pin the current line, so
+    // that its text remains valid without making a copy.  Beyond the last
+    // line it is an empty string, that does not change.
+    pinned = rex.lnum <= rex.reg_maxline;
+    if (pinned)
     {
-	// Since getting one line may invalidate the other, need to make copy.
-	// Slow!
-	if (rex.line != reg_tofree)
-	{
-	    len = (int)STRLEN(rex.line);
-	    if (reg_tofree == NULL || len >= (int)reg_tofreelen)
-	    {
-		len += 50;	// get some extra
-		vim_free(reg_tofree);
-		reg_tofree = alloc(len);
-		if (reg_tofree == NULL)
-		    return RA_FAIL; // out of memory!
-		reg_tofreelen = len;
-	    }
-	    STRCPY(reg_tofree, rex.line);
-	    rex.input = reg_tofree + (rex.input - rex.line);
-	    rex.line = reg_tofree;
-	}
+	len = (int)(rex.input - rex.line);
+	rex.line = ml_pin_line(rex.reg_buf, rex.reg_firstlnum + rex.lnum,
+									 NULL);
+	rex.input = rex.line + len;
+    }
 
+    for (;;)
+    {
 	// Get the line to compare with.
 	p = reg_getline(clnum);
 	if (clnum == end_lnum)
@@ -1617,27 +1617,40 @@ match_with_backref(
 	// Use case-insensitive compare if rex.reg_ic is set
 	if ((!rex.reg_ic && cstrncmp(p + ccol, rex.input, &len) != 0)
 	    || (rex.reg_ic && MB_STRNICMP(p + ccol, rex.input, len) != 0))
-	    return RA_NOMATCH;  // doesn't match
-	if (bytelen != NULL)
+	    retval = RA_NOMATCH;  // doesn't match
+	else if (bytelen != NULL)
 	    *bytelen += len;
-	if (clnum == end_lnum)
-	    break;		// match and at end!
+	if (retval != RA_MATCH || clnum == end_lnum)
+	    break;		// no match, or match and at end!
 	if (rex.lnum >= rex.reg_maxline)
-	    return RA_NOMATCH;  // text too short
+	{
+	    retval = RA_NOMATCH;  // text too short
+	    break;
+	}
 
-	// Advance to next line.
-	reg_nextline();
+	// Advance to next line and pin it instead of the current one.
+	ml_unpin_line(rex.reg_buf);
+	++rex.lnum;
+	rex.line = ml_pin_line(rex.reg_buf, rex.reg_firstlnum + rex.lnum,
+									 NULL);
+	rex.input = rex.line;
+	fast_breakcheck();
 	if (bytelen != NULL)
 	    *bytelen = 0;
 	++clnum;
 	ccol = 0;
 	if (got_int)
-	    return RA_FAIL;
+	{
+	    retval = RA_FAIL;
+	    break;
+	}
     }
 
-    // found a match!  Note that rex.line may now point to a copy of the line,
-    // that should not matter.
-    return RA_MATCH;
+    // The text of the current line stays valid until another line is
+    // obtained.
+    if (pinned)
+	ml_unpin_line(rex.reg_buf);
+    return retval;
 }
 
 /*
@@ -1753,6 +1766,16 @@ cstrncmp(char_u *s1, char_u *s2, int *n)
 	char_u *p = s1;
 	int n2 = 0;
 	int n1 = *n;
+	int i;
+
+	// Be quick for ASCII text, it only needs ASCII case folding.  When a
+	// non-ASCII byte is found do it the slow way.
+	for (i = 0; i < n1 && s1[i] < 0x80 && s2[i] < 0x80; ++i)
+	    if (s1[i] != s2[i] && TOLOWER_ASC(s1[i]) != TOLOWER_ASC(s2[i]))
+		return TOLOWER_ASC(s1[i]) - TOLOWER_ASC(s2[i]);
+	if (i == n1)
+	    return 0;
+
 	// count the number of characters for byte-length of s1
 	while (n1 > 0 && *p != NUL)
 	{
@@ -1847,23 +1870,37 @@ cstrchr(char_u *s, int c)
 	else
 	    return vim_strchr(s, c);
 
-    if (has_mbyte)
+    if (enc_utf8)
     {
-	for (p = s; *p != NUL; p += (*mb_ptr2len)(p))
+	// ASCII text is compared directly, only other characters need to be
+	// decoded and folded.
+	for (p = s; *p != NUL; )
 	{
-	    int uc = utf_ptr2char(p);
-	    if (enc_utf8 && (c > 0x80 || uc > 0x80))
+	    if (*p < 0x80)
 	    {
+		if (c > 0x80 ? TOLOWER_ASC(*p) == lc : (*p == c || *p == cc))
+		    return p;
+		++p;
+	    }
+	    else
+	    {
+		int uc = utf_ptr2char(p);
+
 		// Do not match an illegal byte.  E.g. 0xff matches 0xc3 0xbf,
 		// not 0xff.
 		// compare with lower case of the character
 		if ((uc < 0x80 || uc != *p) && utf_fold(uc) == lc)
 		    return p;
+		p += utfc_ptr2len(p);
 	    }
-	    else if (*p == c || *p == cc)
-		return p;
 	}
     }
+    else if (has_mbyte)
+    {
+	for (p = s; *p != NUL; p += (*mb_ptr2len)(p))
+	    if (*p == c || *p == cc)
+		return p;
+    }
     else
 	// Faster version for when there are no multi-byte characters.
 	for (p = s; *p != NUL; ++p)
@@ -1873,6 +1910,225 @@ cstrchr(char_u *s, int c)
     return NULL;
 }
 
+// Set of bytes, as used for "regfirst".
+#define REGFIRST_ADD(set, b)	((set)[(b) >> 3] |= 1 << ((b) & 7))
+#define REGFIRST_HAS(set, b)	((set)[(b) >> 3] & (1 << ((b) & 7)))
+
+/*
+ * Add string "str" with length "len" to the strings of which one must appear
+ * in a match.  The string is not copied.
+ */
+    static void
+reg_must_add(regmust_T *must, char_u *str, int len)
+{
+    must->str[must->count] = str;
+    must->len[must->count] = len;
+    ++must->count;
+
+    // Also mark the other case, so that the table can be used with
+    // 'ignorecase'.
+    must->first[*str] = TRUE;
+    must->first[TOLOWER_ASC(*str)] = TRUE;
+    must->first[TOUPPER_ASC(*str)] = TRUE;
+}
+
+/*
+ * Return TRUE if the text at "s" starts with "str", which has "len" bytes.
+ * Ignores case if rex.reg_ic is set, the same way as matching a character.
+ */
+    static int
+reg_must_equal(char_u *s, char_u *str, int len)
+{
+    char_u  *end = str + len;
+    int	    c1;
+    int	    c2;
+
+    if (!rex.reg_ic)
+	return STRNCMP(s, str, len) == 0;
+
+    // The text may have a different byte length, e.g. 'ſ' matches 's'.
+    while (str < end)
+    {
+	if (enc_utf8 && *s < 0x80 && *str < 0x80)
+	{
+	    // ASCII only needs ASCII case folding.
+	    if (*s != *str && TOLOWER_ASC(*s) != TOLOWER_ASC(*str))
+		return FALSE;
+	    ++s;
+	    ++str;
+	    continue;
+	}
+	c1 = mb_ptr2char_adv(&s);
+	c2 = mb_ptr2char_adv(&str);
+	if (c1 != c2 && MB_CASEFOLD(c1) != MB_CASEFOLD(c2))
+	    return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * Check whether one of the strings in "must" appears in "s".
+ * Returns FALSE when none does, there then cannot be a match.
+ */
+    static int
+reg_must_find(regmust_T *must, char_u *s)
+{
+    int	    i;
+    int	    c;
+
+    // Composing characters may be ignored, don't bother.
+    if (rex.reg_icombine)
+	return TRUE;
+
+    if (must->count == 1)
+    {
+	if (has_mbyte)
+	    c = (*mb_ptr2char)(must->str[0]);
+	else
+	    c = *must->str[0];
+
+	// This is used very often, esp. for ":global".  Use three versions of
+	// the loop to avoid overhead of conditions.
+	if (!rex.reg_ic && !has_mbyte)
+	    while ((s = vim_strbyte(s, c)) != NULL)
+	    {
+		if (reg_must_equal(s, must->str[0], must->len[0]))
+		    break;		// Found it.
+		++s;
+	    }
+	else if (!rex.reg_ic || (!enc_utf8 && mb_char2len(c) > 1))
+	    while ((s = vim_strchr(s, c)) != NULL)
+	    {
+		if (reg_must_equal(s, must->str[0], must->len[0]))
+		    break;		// Found it.
+		MB_PTR_ADV(s);
+	    }
+	else
+	    while ((s = cstrchr(s, c)) != NULL)
+	    {
+		if (reg_must_equal(s, must->str[0], must->len[0]))
+		    break;		// Found it.
+		MB_PTR_ADV(s);
+	    }
+	return s != NULL;
+    }
+
+    // Several strings: look for a byte that one of them starts with and only
+    // then compare the strings.  When ignoring case a non-ASCII character
+    // may fold to an ASCII one, e.g. the Kelvin sign to "k".
+    for ( ; *s != NUL; ++s)
+    {
+	if (!must->first[*s] && !(rex.reg_ic
+				    && (enc_utf8 ? *s >= 0xc0 : *s >= 0x80)))
+	    continue;
+	for (i = 0; i < must->count; ++i)
+	    if (reg_must_equal(s, must->str[i], must->len[i]))
+		return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+ * Return a guess of how often byte "c" appears in text, higher is more often.
+ */
+    static int
+reg_byte_frequency(int c)
+{
+    static char	*letters = "zqjxkvbywgpfmucdlhrsnioate";
+
+    if (c >= 0x80)
+	return 0;
+    if (vim_strchr((char_u *)" \t_(),;.=*-\"/", c) != NULL)
+	return 100;
+    if (ASCII_ISLOWER(c))
+	return 70 + (int)(vim_strchr((char_u *)letters, c) - (char_u *)letters);
+    if (ASCII_ISUPPER(c))
+	return 40 + (int)(vim_strchr((char_u *)letters, TOLOWER_ASC(c))
+							 - (char_u *)letters);
+    if (VIM_ISDIGIT(c))
+	return 50;
+    return 20;
+}
+
+/*
+ * Add a byte of each string in "must" to the set of bytes "set".  Every byte
+ * of a string must appear, the one that is least likely to appear in text is
+ * used.  "ic" is TRUE when ignoring case.
+ * Returns FAIL when this is not known.
+ */
+    static int
+reg_need_add_must(char_u *set, regmust_T *must, int ic)
+{
+    int	    i;
+    int	    j;
+    int	    c;
+    int	    best;
+    int	    freq;
+    int	    best_freq = 0;
+
+    for (i = 0; i < must->count; ++i)
+    {
+	best = NUL;
+	for (j = 0; j < must->len[i]; ++j)
+	{
+	    c = must->str[i][j];
+	    // A non-ASCII character may fold to ASCII, e.g. the Kelvin sign
+	    // to "k".
+	    if (ic && c >= 0x80)
+		continue;
+	    freq = reg_byte_frequency(ic ? TOLOWER_ASC(c) : c);
+	    if (best == NUL || freq < best_freq)
+	    {
+		best = c;
+		best_freq = freq;
+	    }
+	}
+	if (best == NUL)
+	    return FAIL;
+	REGFIRST_ADD(set, best);
+	if (ic)
+	{
+	    REGFIRST_ADD(set, TOLOWER_ASC(best));
+	    REGFIRST_ADD(set, TOUPPER_ASC(best));
+	}
+    }
+    // Text with a non-ASCII character may fold to a string.
+    if (ic)
+	for (i = 0x80; i <= 0xff; ++i)
+	    REGFIRST_ADD(set, i);
+    return OK;
+}
+
+/*
+ * Add the bytes with which character "c" can be matched to the set of bytes
+ * "set".  "ic" is TRUE when ignoring case.
+ * Returns FAIL when this is not known.
+ */
+    static int
+reg_need_add_char(char_u *set, int c, int ic)
+{
+    char_u  buf[MB_MAXBYTES + 1];
+    int	    i;
+
+    if (ic)
+    {
+	if (c >= 0x80)
+	    return FAIL;
+	REGFIRST_ADD(set, TOLOWER_ASC(c));
+	REGFIRST_ADD(set, TOUPPER_ASC(c));
+	for (i = 0x80; i <= 0xff; ++i)
+	    REGFIRST_ADD(set, i);
+    }
+    else if (has_mbyte)
+    {
+	(void)(*mb_char2bytes)(c, buf);
+	REGFIRST_ADD(set, buf[0]);
+    }
+    else
+	REGFIRST_ADD(set, c);
+    return OK;
+}
+
 ////////////////////////////////////////////////////////////////
 //		      regsub stuff			      //
 ////////////////////////////////////////////////////////////////
@@ -2884,7 +3140,9 @@ static regengine_T bt_regengine =
     bt_regcomp,
     bt_regfree,
     bt_regexec_nl,
-    bt_regexec_multi
+    bt_regexec_multi,
+    bt_regmay_match,
+    bt_regneed
 #ifdef DEBUG
     ,(char_u *)""
 #endif
@@ -2897,7 +3155,9 @@ static regengine_T nfa_regengine =
     nfa_regcomp,
     nfa_regfree,
     nfa_regexec_nl,
-    nfa_regexec_multi
+    nfa_regexec_multi,
+    nfa_regmay_match,
+    nfa_regneed
 #ifdef DEBUG
     ,(char_u *)""
 #endif
@@ -2915,6 +3175,106 @@ static char_u regname[][30] = {
 			    };
 #endif
 
+/*
+ * Compiled programs are kept for reuse when they are freed, so that using
+ * the same pattern again, e.g. for "=~" in a loop, does not compile it again.
+ * A program taken from the cache by vim_regcomp() is marked in use until
+ * vim_regfree() is called for it.  When the least recently used entry is
+ * dropped while in use the program is freed by vim_regfree() as usual.
+ */
+#define REG_CACHE_SIZE	32
+
+typedef struct
+{
+    char_u	*rc_pat;	// pattern, allocated, NULL for an empty entry
+    hash_T	rc_hash;	// hash of "rc_pat"
+    int		rc_flags;	// "re_flags" passed to vim_regcomp()
+    int		rc_state;	// see regcache_state()
+    regprog_T	*rc_prog;	// the compiled program
+    int		rc_in_use;	// "rc_prog" was returned by vim_regcomp()
+    long_u	rc_used;	// when last used, for dropping the oldest
+} regcache_T;
+
+static regcache_T   regcache[REG_CACHE_SIZE];
+static long_u	    regcache_tick = 0;
+static long	    regcache_hits = 0;
+static long	    regcache_misses = 0;
+static long	    regcache_switched = 0;
+
+/*
+ * Return the state, other than the pattern and flags, that compiling a
+ * pattern depends on: the engine and the 'cpoptions' and 'encoding' values.
+ */
+    static int
+regcache_state(void)
+{
+    return (int)p_re
+	+ (vim_strchr(p_cpo, CPO_LITERAL) != NULL ? 0x04 : 0)
+	+ (vim_strchr(p_cpo, CPO_BACKSL) != NULL ? 0x08 : 0)
+	+ (enc_utf8 ? 0x10 : 0)
+	+ (has_mbyte ? 0x20 : 0)
+	+ (enc_dbcs << 8);
+}
+
+/*
+ * Return TRUE when the program compiled for "expr" only depends on the
+ * pattern, the flags and regcache_state().  Not when it contains "~", which
+ * inserts the previous substitute string, a class like "[:keyword:]", which
+ * uses the current option value, or "\%.l", "\%<.c", etc., which use the
+ * cursor position.
+ */
+    static int
+regcache_usable(char_u *expr)
+{
+    char_u	*p;
+
+#ifdef FEAT_SYN_HL
+    // "\z(" depends on where the pattern is used.
+    if (reg_do_extmatch != 0)
+	return FALSE;
+#endif
+    for (p = expr; (p = vim_strchr(p, '%')) != NULL; ++p)
+	if (p[1] == '.' || ((p[1] == '<' || p[1] == '>') && p[2] == '.'))
+	    return FALSE;
+    return vim_strchr(expr, '~') == NULL
+				   && strstr((char *)expr, "[:") == NULL;
+}
+
+/*
+ * Drop cache entry "rc".  The program is freed unless it is in use.
+ */
+    static void
+regcache_drop(regcache_T *rc)
+{
+    if (!rc->rc_in_use)
+	rc->rc_prog->engine->regfree(rc->rc_prog);
+    VIM_CLEAR(rc->rc_pat);
+    rc->rc_prog = NULL;
+    rc->rc_in_use = FALSE;
+}
+
+/*
+ * Called when the NFA engine was too slow for "prog" and "newprog" was
+ * compiled with the backtracking engine to replace it.  When "prog" is cached
+ * the entry gets "newprog", so that using the pattern again does not try the
+ * NFA engine again.
+ * Frees "prog".
+ */
+    static void
+regcache_switch(regprog_T *prog, regprog_T *newprog)
+{
+    int		i;
+
+    ++regcache_switched;
+    for (i = 0; i < REG_CACHE_SIZE; ++i)
+	if (regcache[i].rc_prog == prog)
+	{
+	    regcache[i].rc_prog = newprog;
+	    break;
+	}
+    prog->engine->regfree(prog);
+}
+
 /*
  * Compile a regular expression into internal code.
  * Returns the program in allocated memory.
@@ -2922,7 +3282,81 @@ static char_u regname[][30] = {
  * Returns NULL for an error.
  */
     regprog_T *
-vim_regcomp(char_u *expr_arg, int re_flags)
+vim_regcomp(char_u *expr, int re_flags)
+{
+    regprog_T	*prog;
+    regcache_T	*rc;
+    regcache_T	*oldest = NULL;
+    int		usable = regcache_usable(expr);
+    int		state = 0;
+    hash_T	hash = 0;
+    int		called_emsg_before = called_emsg;
+    int		i;
+
+    if (usable)
+    {
+	state = regcache_state();
+	hash = hash_hash(expr);
+	for (i = 0; i < REG_CACHE_SIZE; ++i)
+	{
+	    rc = &regcache[i];
+	    if (rc->rc_pat == NULL)
+	    {
+		if (oldest == NULL || oldest->rc_pat != NULL)
+		    oldest = rc;
+		continue;
+	    }
+	    if (rc->rc_hash == hash && rc->rc_flags == re_flags
+			&& rc->rc_state == state && STRCMP(rc->rc_pat, expr) == 0)
+	    {
+		if (rc->rc_in_use)
+		{
+		    // Used recursively, need another program that is not
+		    // cached.
+		    usable = FALSE;
+		    break;
+		}
+		++regcache_hits;
+		rc->rc_in_use = TRUE;
+		rc->rc_used = ++regcache_tick;
+		return rc->rc_prog;
+	    }
+	    if (oldest == NULL || (oldest->rc_pat != NULL
+					     && rc->rc_used < oldest->rc_used))
+		oldest = rc;
+	}
+	++regcache_misses;
+    }
+
+    prog = regcomp_uncached(expr, re_flags);
+
+    // Do not cache when an error was given, it would not be given again.
+    if (prog != NULL && usable && oldest != NULL
+					   && called_emsg == called_emsg_before)
+    {
+	char_u *pat = vim_strsave(expr);
+
+	if (pat != NULL)
+	{
+	    if (oldest->rc_pat != NULL)
+		regcache_drop(oldest);
+	    oldest->rc_pat = pat;
+	    oldest->rc_hash = hash;
+	    oldest->rc_flags = re_flags;
+	    oldest->rc_state = state;
+	    oldest->rc_prog = prog;
+	    oldest->rc_in_use = TRUE;
+	    oldest->rc_used = ++regcache_tick;
+	}
+    }
+    return prog;
+}
+
+/*
+ * Compile a regular expression, without using the cache.
+ */
+    static regprog_T *
+regcomp_uncached(char_u *expr_arg, int re_flags)
 {
     regprog_T   *prog = NULL;
     char_u	*expr = expr_arg;
@@ -3021,17 +3455,57 @@ vim_regcomp(char_u *expr_arg, int re_flags)
     void
 vim_regfree(regprog_T *prog)
 {
-    if (prog != NULL)
-	prog->engine->regfree(prog);
+    int		i;
+
+    if (prog == NULL)
+	return;
+
+    // A cached program is kept for the next vim_regcomp().
+    for (i = 0; i < REG_CACHE_SIZE; ++i)
+	if (regcache[i].rc_prog == prog)
+	{
+	    regcache[i].rc_in_use = FALSE;
+	    return;
+	}
+    prog->engine->regfree(prog);
 }
 
+#if defined(FEAT_EVAL) || defined(PROTO)
+/*
+ * "regcachestats()" function
+ */
+    void
+f_regcachestats(typval_T *argvars UNUSED, typval_T *rettv)
+{
+    int		i;
+    int		count = 0;
+
+    if (rettv_dict_alloc(rettv) == FAIL)
+	return;
+
+    for (i = 0; i < REG_CACHE_SIZE; ++i)
+	if (regcache[i].rc_pat != NULL)
+	    ++count;
+    dict_add_number(rettv->vval.v_dict, "hits", regcache_hits);
+    dict_add_number(rettv->vval.v_dict, "misses", regcache_misses);
+    dict_add_number(rettv->vval.v_dict, "switched", regcache_switched);
+    dict_add_number(rettv->vval.v_dict, "count", count);
+    dict_add_number(rettv->vval.v_dict, "size", REG_CACHE_SIZE);
+}
+#endif
+
 #if defined(EXITFREE) || defined(PROTO)
     void
 free_regexp_stuff(void)
 {
+    int		i;
+
+    for (i = 0; i < REG_CACHE_SIZE; ++i)
+	if (regcache[i].rc_pat != NULL)
+	    regcache_drop(&regcache[i]);
     ga_clear(&regstack);
     ga_clear(&backpos);
-    vim_free(reg_tofree);
+    nfa_pool_free();
     vim_free(reg_prev_sub);
 }
 #endif
@@ -3111,15 +3585,25 @@ vim_regexec_string(
 	char_u *pat = vim_strsave(((nfa_regprog_T *)rmp->regprog)->pattern);
 
 	p_re = BACKTRACKING_ENGINE;
-	vim_regfree(rmp->regprog);
-	if (pat != NULL)
+	if (pat == NULL)
 	{
+	    vim_regfree(rmp->regprog);
+	    rmp->regprog = NULL;
+	}
+	else
+	{
+	    regprog_T *prev_prog = rmp->regprog;
+
 #ifdef FEAT_EVAL
 	    report_re_switch(pat);
 #endif
-	    rmp->regprog = vim_regcomp(pat, re_flags);
-	    if (rmp->regprog != NULL)
+	    rmp->regprog = regcomp_uncached(pat, re_flags);
+	    if (rmp->regprog == NULL)
+		vim_regfree(prev_prog);
+	    else
 	    {
+		regcache_switch(prev_prog, rmp->regprog);
+
 		rmp->regprog->re_in_use = TRUE;
 		result = rmp->regprog->engine->regexec_nl(rmp, line, col, nl);
 		rmp->regprog->re_in_use = FALSE;
@@ -3241,7 +3725,7 @@ vim_regexec_multi(
 	    // allow all here
 	    reg_do_extmatch = REX_ALL;
 #endif
-	    rmp->regprog = vim_regcomp(pat, re_flags);
+	    rmp->regprog = regcomp_uncached(pat, re_flags);
 #ifdef FEAT_SYN_HL
 	    reg_do_extmatch = 0;
 #endif
@@ -3253,7 +3737,7 @@ vim_regexec_multi(
 	    }
 	    else
 	    {
-		vim_regfree(prev_prog);
+		regcache_switch(prev_prog, rmp->regprog);
 
 		rmp->regprog->re_in_use = TRUE;
 		result = rmp->regprog->engine->regexec_multi(
@@ -3271,3 +3755,96 @@ vim_regexec_multi(
 
     return result <= 0 ? 0 : result;
 }
+
+// Number of lines checked by vim_regexec_multi_skip() at first and at most.
+#define REG_SKIP_FIRST	8
+#define REG_SKIP_MAX	256
+
+/*
+ * Find the first line from "lnum" to "lnum_end" in buffer "buf" where
+ * "rmp->regprog" may match, to quickly skip over lines that cannot match.
+ * The text is checked where it is in the memline data block, with only the
+ * checks that the regexp engine does before trying to match, without the
+ * setup that vim_regexec_multi() does for every line.
+ * Checks a limited number of lines, so that the caller can check for an
+ * interrupt.  There is no match in the lines before the returned line
+ * number, use vim_regexec_multi() to check the returned line.
+ */
+    linenr_T
+vim_regexec_multi_skip(
+    regmmatch_T *rmp,
+    win_T       *win,		// window in which to search or NULL
+    buf_T       *buf,		// buffer in which to search
+    linenr_T	lnum,		// nr of first line to check
+    linenr_T	lnum_end)	// nr of last line to check
+{
+    regprog_T	*prog = rmp->regprog;
+    char_u	*lines[REG_SKIP_MAX];
+    int		batch;
+    int		count;
+    int		i;
+    regexec_T	rex_save;
+    int		rex_in_use_save = rex_in_use;
+
+    if (prog == NULL || prog->re_in_use || lnum > lnum_end
+					  || lnum > buf->b_ml.ml_line_count)
+	return lnum;
+    if (lnum_end > buf->b_ml.ml_line_count)
+	lnum_end = buf->b_ml.ml_line_count;
+    prog->re_in_use = TRUE;
+
+    if (rex_in_use)
+	// Being called recursively, save the state.
+	rex_save = rex;
+    rex_in_use = TRUE;
+
+    init_regexec_multi(rmp, win, buf, lnum);
+    if (prog->regflags & RF_ICASE)
+	rex.reg_ic = TRUE;
+    else if (prog->regflags & RF_NOICASE)
+	rex.reg_ic = FALSE;
+    if (prog->regflags & RF_ICOMBINE)
+	rex.reg_icombine = TRUE;
+
+    // Start with a few lines, the first line often matches and then getting
+    // the pointers for the whole block would be wasted.
+    for (batch = REG_SKIP_FIRST; ; batch = REG_SKIP_MAX)
+    {
+	count = ml_pin_lines(buf, lnum, lnum_end, lines, batch);
+	for (i = 0; i < count; ++i)
+	    if (prog->engine->regmay_match(prog, lines[i]))
+		break;
+	ml_unpin_line(buf);
+	lnum += i;
+	if (i < count || count < batch || batch == REG_SKIP_MAX
+							   || lnum > lnum_end)
+	    break;
+    }
+
+    prog->re_in_use = FALSE;
+    rex_in_use = rex_in_use_save;
+    if (rex_in_use)
+	rex = rex_save;
+
+    return lnum;
+}
+
+/*
+ * Set the bits in "set", which has 32 bytes, for the bytes of which one must
+ * appear in a line for "prog" to match in that line.  "ic" is TRUE when
+ * ignoring case.  Used to skip matching in a line that contains none of
+ * them.
+ * Returns FAIL when this is not known.
+ */
+    int
+vim_regneed(regprog_T *prog, int ic, char_u *set)
+{
+    vim_memset(set, 0, 32);
+    if (prog == NULL || (prog->regflags & RF_ICOMBINE))
+	return FAIL;
+    if (prog->regflags & RF_ICASE)
+	ic = TRUE;
+    else if (prog->regflags & RF_NOICASE)
+	ic = FALSE;
+    return prog->engine->regneed(prog, ic, set);
+}
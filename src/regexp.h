@@ -55,6 +55,21 @@ typedef struct regprog
     int			re_in_use;   // prog is being executed
 } regprog_T;
 
+#define REG_MUST_MAX	8	// max number of strings in regmust_T
+
+/*
+ * Strings of which at least one must appear in a match, used to quickly skip
+ * lines that cannot match.  Not used when "count" is zero.
+ */
+typedef struct
+{
+    int			count;		    // number of strings
+    char_u		*str[REG_MUST_MAX];
+    int			len[REG_MUST_MAX];  // byte length of each string
+    char_u		first[256];	    // TRUE for a byte that a string
+					    // starts with, in either case
+} regmust_T;
+
 /*
  * Structure used by the back track matcher.
  * These fields are only to be used in regexp.c!
@@ -70,9 +85,11 @@ typedef struct
     int			re_in_use;
 
     int			regstart;
+    char_u		*regstart_str;
     char_u		reganch;
-    char_u		*regmust;
-    int			regmlen;
+    regmust_T		regmust;
+    char_u		regfirstok;
+    char_u		regfirst[32];
 #ifdef FEAT_SYN_HL
     char_u		reghasz;
 #endif
@@ -94,6 +111,9 @@ struct nfa_state
     int			val;
 };
 
+// Lazily built DFA for the NFA matcher, see regexp_nfa.c.
+typedef struct nfa_dfa_S nfa_dfa_T;
+
 /*
  * Structure used by the NFA matcher.
  */
@@ -111,6 +131,7 @@ typedef struct
     int			reganch;	// pattern starts with ^
     int			regstart;	// char at start of pattern
     char_u		*match_text;	// plain text to match with
+    regmust_T		regmust;	// strings a match must contain
 
     int			has_zend;	// pattern contains \ze
     int			has_backref;	// pattern contains \1 .. \9
@@ -119,6 +140,8 @@ typedef struct
 #endif
     char_u		*pattern;
     int			nsubexp;	// number of ()
+    int			use_dfa;	// whether nfa_dfa_may_match() can be used
+    nfa_dfa_T		*dfa;		// DFA states or NULL
     int			nstate;
     nfa_state_T		state[1];	// actually longer..
 } nfa_regprog_T;
@@ -178,6 +201,10 @@ struct regengine
     int		(*regexec_nl)(regmatch_T *, char_u *, colnr_T, int);
     // bt_regexec_mult or nfa_regexec_mult
     long	(*regexec_multi)(regmmatch_T *, win_T *, buf_T *, linenr_T, colnr_T, int *);
+    // bt_regmay_match or nfa_regmay_match
+    int		(*regmay_match)(regprog_T *, char_u *);
+    // bt_regneed or nfa_regneed
+    int		(*regneed)(regprog_T *, int, char_u *);
 #ifdef DEBUG
     char_u	*expr;
 #endif
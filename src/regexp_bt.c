@@ -47,19 +47,22 @@
  *
  * regstart	char that must begin a match; NUL if none obvious; Can be a
  *		multi-byte character.
+ * regstart_str	literal string that must begin a match, starting with
+ *		regstart; NULL if none
  * reganch	is the match anchored (at beginning-of-line only)?
- * regmust	string (pointer into program) that match must include, or NULL
- * regmlen	length of regmust string
+ * regmust	strings (pointers into program) of which a match must include
+ *		one, "regmust.count" is zero if none
+ * regfirst	bitmap of the bytes a match can start with, only valid when
+ *		"regfirstok" is TRUE; used when there is no regstart
  * regflags	RF_ values or'ed together
  *
  * Regstart and reganch permit very fast decisions on suitable starting points
  * for a match, cutting down the work a lot.  Regmust permits fast rejection
  * of lines that cannot possibly match.  The regmust tests are costly enough
  * that vim_regcomp() supplies a regmust only if the r.e. contains something
- * potentially expensive (at present, the only such thing detected is * or +
- * at the start of the r.e., which can involve a lot of backup).  Regmlen is
- * supplied because the test in vim_regexec() needs it and vim_regcomp() is
- * computing it anyway.
+ * potentially expensive (at present, the only such things detected are * or +
+ * at the start of the r.e., which can involve a lot of backup, and several
+ * top-level alternatives, which must all be tried at every position).
  */
 
 /*
@@ -1476,6 +1479,7 @@ regatom(int *flagp)
 		case 's': ret = regnode(MOPEN + 0);
 			  if (re_mult_next("\\zs") == FAIL)
 			      return NULL;
+			  regflags |= RF_ZSTART;
 			  break;
 
 		case 'e': ret = regnode(MCLOSE + 0);
@@ -2461,6 +2465,176 @@ reg(
     return ret;
 }
 
+/*
+ * Add character "c" to the set of first bytes "set".  Since 'ignorecase' is
+ * only known when executing, the other case of a letter is added too, and
+ * all non-ASCII bytes for characters that fold to it.
+ */
+    static void
+regfirst_add_char(char_u *set, int c)
+{
+    int	    i;
+
+    if (c >= 0x80 || ASCII_ISALPHA(c))
+	for (i = 0x80; i <= 0xff; ++i)
+	    REGFIRST_ADD(set, i);
+    if (c >= 0x80 && enc_utf8)
+	c = utf_fold(c);
+    if (c < 0x80)
+    {
+	REGFIRST_ADD(set, c);
+	if (ASCII_ISALPHA(c))
+	{
+	    REGFIRST_ADD(set, TOLOWER_ASC(c));
+	    REGFIRST_ADD(set, TOUPPER_ASC(c));
+	}
+    }
+}
+
+/*
+ * Add the bytes with which text matching the nodes from "scan" onwards can
+ * start to "set".  Returns FAIL when this is not known, e.g. when the nodes
+ * may match an empty string or use an option-dependent class.
+ */
+    static int
+regfirst_add(char_u *scan, char_u *set, int depth)
+{
+    char_u  *p;
+    char_u  *next;
+    int	    op;
+    int	    mask;
+    int	    i;
+
+    if (depth > 10)
+	return FAIL;
+    for ( ; scan != NULL; scan = regnext(scan))
+    {
+	op = OP(scan);
+	if (WITH_NL(op) || op == NEWL)
+	{
+	    // A line break matches at the NUL of a line or at a NL when the
+	    // text contains line breaks.
+	    REGFIRST_ADD(set, NUL);
+	    REGFIRST_ADD(set, '\n');
+	    if (op == NEWL)
+		return OK;
+	    op -= ADD_NL;
+	}
+
+	switch (op)
+	{
+	    case BOL:
+	    case EOL:
+	    case BOW:
+	    case EOW:
+	    case NOTHING:
+	    case NOPEN:
+	    case NCLOSE:
+	    case RE_BOF:
+	    case RE_EOF:
+	    case CURSOR:
+	    case RE_LNUM:
+	    case RE_COL:
+	    case RE_VCOL:
+	    case RE_MARK:
+	    case RE_VISUAL:
+		// Matches without consuming text.
+		continue;
+
+	    case BRANCH:
+		next = regnext(scan);
+		if (next == NULL || OP(next) != BRANCH)
+		{
+		    // Only one alternative.
+		    scan = OPERAND(scan);
+		    if (regfirst_add(scan, set, depth + 1) == FAIL)
+			return FAIL;
+		    return OK;
+		}
+		for ( ; scan != NULL && OP(scan) == BRANCH;
+						       scan = regnext(scan))
+		    if (regfirst_add(OPERAND(scan), set, depth + 1) == FAIL)
+			return FAIL;
+		return OK;
+
+	    case STAR:
+		if (regfirst_add(OPERAND(scan), set, depth + 1) == FAIL)
+		    return FAIL;
+		continue;
+
+	    case PLUS:
+		return regfirst_add(OPERAND(scan), set, depth + 1);
+
+	    case BRACE_LIMITS:
+		next = regnext(scan);
+		if (next == NULL || OP(next) != BRACE_SIMPLE)
+		    return FAIL;
+		if (regfirst_add(OPERAND(next), set, depth + 1) == FAIL)
+		    return FAIL;
+		if (OPERAND_MIN(scan) > 0 && OPERAND_MAX(scan) > 0)
+		    return OK;
+		scan = next;
+		continue;
+
+	    case EXACTLY:
+		p = OPERAND(scan);
+		if (*p == NUL)
+		    return FAIL;
+		regfirst_add_char(set, has_mbyte ? (*mb_ptr2char)(p) : *p);
+		return OK;
+
+	    case MULTIBYTECODE:
+		regfirst_add_char(set, (*mb_ptr2char)(OPERAND(scan)));
+		return OK;
+
+	    case ANYOF:
+		for (p = OPERAND(scan); *p != NUL; )
+		{
+		    regfirst_add_char(set, has_mbyte ? (*mb_ptr2char)(p) : *p);
+		    p += has_mbyte ? (*mb_ptr2len)(p) : 1;
+		}
+		return OK;
+
+	    case ANYBUT:
+		// Any character other than the listed ASCII ones.
+		for (i = 1; i <= 0xff; ++i)
+		    if (i >= 0x80 || vim_strchr(OPERAND(scan), i) == NULL)
+			REGFIRST_ADD(set, i);
+		return OK;
+
+	    case WHITE:  case NWHITE:	mask = RI_WHITE; break;
+	    case DIGIT:  case NDIGIT:	mask = RI_DIGIT; break;
+	    case HEX:    case NHEX:	mask = RI_HEX; break;
+	    case OCTAL:  case NOCTAL:	mask = RI_OCTAL; break;
+	    case WORD:   case NWORD:	mask = RI_WORD; break;
+	    case HEAD:   case NHEAD:	mask = RI_HEAD; break;
+	    case ALPHA:  case NALPHA:	mask = RI_ALPHA; break;
+	    case LOWER:  case NLOWER:	mask = RI_LOWER; break;
+	    case UPPER:  case NUPPER:	mask = RI_UPPER; break;
+
+	    default:
+		if ((op >= MOPEN && op <= MOPEN + 9)
+			|| (op >= MCLOSE && op <= MCLOSE + 9)
+#ifdef FEAT_SYN_HL
+			|| (op >= ZOPEN && op <= ZOPEN + 9)
+			|| (op >= ZCLOSE && op <= ZCLOSE + 9)
+#endif
+			)
+		    continue;
+		// END, BACK, ANY, back references, look-around, etc.
+		return FAIL;
+	}
+
+	// A character class.  These only contain ASCII characters, the
+	// negated ones (which have an even number) match anything else.
+	for (i = 1; i <= 0xff; ++i)
+	    if ((i < 0x80 && (class_tab[i] & mask)) != ((op & 1) == 0))
+		REGFIRST_ADD(set, i);
+	return OK;
+    }
+    return FAIL;
+}
+
 /*
  * bt_regcomp() - compile a regular expression into internal code for the
  * traditional back track matcher.
@@ -2523,9 +2697,9 @@ bt_regcomp(char_u *expr, int re_flags)
 
     // Dig out information for optimizations.
     r->regstart = NUL;		// Worst-case defaults.
+    r->regstart_str = NULL;
     r->reganch = 0;
-    r->regmust = NULL;
-    r->regmlen = 0;
+    CLEAR_FIELD(r->regmust);
     r->regflags = regflags;
     if (flags & HASNL)
 	r->regflags |= RF_HASNL;
@@ -2553,6 +2727,7 @@ bt_regcomp(char_u *expr, int re_flags)
 		r->regstart = (*mb_ptr2char)(OPERAND(scan));
 	    else
 		r->regstart = *OPERAND(scan);
+	    r->regstart_str = OPERAND(scan);
 	}
 	else if ((OP(scan) == BOW
 		    || OP(scan) == EOW
@@ -2565,6 +2740,7 @@ bt_regcomp(char_u *expr, int re_flags)
 		r->regstart = (*mb_ptr2char)(OPERAND(regnext(scan)));
 	    else
 		r->regstart = *OPERAND(regnext(scan));
+	    r->regstart_str = OPERAND(regnext(scan));
 	}
 
 	// If there's something expensive in the r.e., find the longest
@@ -2595,10 +2771,47 @@ bt_regcomp(char_u *expr, int re_flags)
 		    }
 		}
 	    }
-	    r->regmust = longest;
-	    r->regmlen = len;
+	    if (longest != NULL)
+		reg_must_add(&r->regmust, longest, len);
 	}
     }
+    else if (!(flags & HASNL))
+    {
+	// Several top-level choices.  When each of them includes a literal
+	// string, a match must include one of these strings.
+	for ( ; OP(scan) == BRANCH; scan = regnext(scan))
+	{
+	    char_u  *p;
+	    size_t  scanlen;
+
+	    longest = NULL;
+	    len = 0;
+	    for (p = OPERAND(scan); p != NULL && OP(p) != END; p = regnext(p))
+	    {
+		if (OP(p) == EXACTLY)
+		{
+		    scanlen = STRLEN(OPERAND(p));
+		    if (scanlen >= (size_t)len)
+		    {
+			longest = OPERAND(p);
+			len = (int)scanlen;
+		    }
+		}
+	    }
+	    if (longest == NULL || r->regmust.count == REG_MUST_MAX)
+	    {
+		CLEAR_FIELD(r->regmust);
+		break;
+	    }
+	    reg_must_add(&r->regmust, longest, len);
+	}
+    }
+
+    // Without a known first character, find out with which bytes a match can
+    // start, so that other positions can be skipped quickly.
+    CLEAR_FIELD(r->regfirst);
+    r->regfirstok = !r->reganch && r->regstart == NUL
+			&& regfirst_add(r->program + 1, r->regfirst, 0) == OK;
 #ifdef BT_REGEXP_DUMP
     regdump(expr, r);
 #endif
@@ -3726,7 +3939,10 @@ regmatch(
 		if (*opnd != *rex.input
 			&& (!rex.reg_ic
 			    || (!enc_utf8
-			      && MB_TOLOWER(*opnd) != MB_TOLOWER(*rex.input))))
+			      && MB_TOLOWER(*opnd) != MB_TOLOWER(*rex.input))
+			    || (*opnd < 0x80 && *rex.input < 0x80
+				&& TOLOWER_ASC(*opnd)
+						!= TOLOWER_ASC(*rex.input))))
 		    status = RA_NOMATCH;
 		else if (*opnd == NUL)
 		{
@@ -4969,42 +5185,8 @@ bt_regexec_both(
 	rex.reg_icombine = TRUE;
 
     // If there is a "must appear" string, look for it.
-    if (prog->regmust != NULL)
-    {
-	int c;
-
-	if (has_mbyte)
-	    c = (*mb_ptr2char)(prog->regmust);
-	else
-	    c = *prog->regmust;
-	s = line + col;
-
-	// This is used very often, esp. for ":global".  Use three versions of
-	// the loop to avoid overhead of conditions.
-	if (!rex.reg_ic && !has_mbyte)
-	    while ((s = vim_strbyte(s, c)) != NULL)
-	    {
-		if (cstrncmp(s, prog->regmust, &prog->regmlen) == 0)
-		    break;		// Found it.
-		++s;
-	    }
-	else if (!rex.reg_ic || (!enc_utf8 && mb_char2len(c) > 1))
-	    while ((s = vim_strchr(s, c)) != NULL)
-	    {
-		if (cstrncmp(s, prog->regmust, &prog->regmlen) == 0)
-		    break;		// Found it.
-		MB_PTR_ADV(s);
-	    }
-	else
-	    while ((s = cstrchr(s, c)) != NULL)
-	    {
-		if (cstrncmp(s, prog->regmust, &prog->regmlen) == 0)
-		    break;		// Found it.
-		MB_PTR_ADV(s);
-	    }
-	if (s == NULL)		// Not present.
-	    goto theend;
-    }
+    if (prog->regmust.count > 0 && !reg_must_find(&prog->regmust, line + col))
+	goto theend;
 
     rex.line = line;
     rex.lnum = 0;
@@ -5049,6 +5231,27 @@ bt_regexec_both(
 		}
 		col = (int)(s - rex.line);
 	    }
+	    else if (prog->regfirstok)
+	    {
+		// Skip positions where the byte can't start a match, without
+		// going through regtry().
+		s = rex.line + col;
+		while (!REGFIRST_HAS(prog->regfirst, *s))
+		{
+		    if (*s == NUL)
+			break;
+		    if (has_mbyte && *s >= 0x80)
+			s += (*mb_ptr2len)(s);
+		    else
+			++s;
+		}
+		if (!REGFIRST_HAS(prog->regfirst, *s))
+		{
+		    retval = 0;
+		    break;
+		}
+		col = (int)(s - rex.line);
+	    }
 
 	    // Check for maximum column to try.
 	    if (rex.reg_maxcol > 0 && col >= rex.reg_maxcol)
@@ -5081,10 +5284,7 @@ bt_regexec_both(
     }
 
 theend:
-    // Free "reg_tofree" when it's a bit big.
     // Free regstack and backpos if they are bigger than their initial size.
-    if (reg_tofreelen > 400)
-	VIM_CLEAR(reg_tofree);
     if (regstack.ga_maxlen > REGSTACK_INITIAL)
 	ga_clear(&regstack);
     if (backpos.ga_maxlen > BACKPOS_INITIAL)
@@ -5170,6 +5370,80 @@ bt_regexec_multi(
     return bt_regexec_both(NULL, col, timed_out);
 }
 
+/*
+ * Check whether "rprog" may match in "line", using only quick checks for
+ * the text that a match must contain.
+ * "rex" must have been set up for the buffer.
+ * Returns FALSE when there certainly is no match.
+ */
+    static int
+bt_regmay_match(regprog_T *rprog, char_u *line)
+{
+    bt_regprog_T    *prog = (bt_regprog_T *)rprog;
+
+    if (prog->regmust.count > 0 && !reg_must_find(&prog->regmust, line))
+	return FALSE;
+    if (prog->regstart != NUL && !prog->reganch)
+    {
+	char_u	*s;
+	size_t	len;
+
+	if (rex.reg_ic)
+	    return cstrchr(line, prog->regstart) != NULL;
+
+	// Look for the whole literal text the match starts with, a match of
+	// the first byte alone is too common.
+	if (prog->regstart_str != NULL && !rex.reg_icombine)
+	{
+	    len = STRLEN(prog->regstart_str);
+	    for (s = vim_strbyte(line, *prog->regstart_str); s != NULL;
+			       s = vim_strbyte(s + 1, *prog->regstart_str))
+		if (STRNCMP(s, prog->regstart_str, len) == 0)
+		    return TRUE;
+	    return FALSE;
+	}
+	if (!has_mbyte)
+	    return vim_strbyte(line, prog->regstart) != NULL;
+	return cstrchr(line, prog->regstart) != NULL;
+    }
+    if (prog->regfirstok && !REGFIRST_HAS(prog->regfirst, NUL))
+    {
+	char_u	*s;
+
+	// A byte that a match can start with must appear.  Trail bytes may
+	// give a false positive, that is fine.
+	for (s = line; !REGFIRST_HAS(prog->regfirst, *s); ++s)
+	    if (*s == NUL)
+		return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * Add the bytes of which one must appear in a line for "rprog" to match in it
+ * to "set".  "ic" is TRUE when ignoring case.
+ * Returns FAIL when this is not known.
+ */
+    static int
+bt_regneed(regprog_T *rprog, int ic, char_u *set)
+{
+    bt_regprog_T    *prog = (bt_regprog_T *)rprog;
+    int		    i;
+
+    if (prog->regmust.count > 0)
+	return reg_need_add_must(set, &prog->regmust, ic);
+    if (prog->regstart != NUL)
+	return reg_need_add_char(set, prog->regstart, ic);
+    // "regfirst" already includes other cases.
+    if (prog->regfirstok && !REGFIRST_HAS(prog->regfirst, NUL))
+    {
+	for (i = 0; i < (int)sizeof(prog->regfirst); ++i)
+	    set[i] |= prog->regfirst[i];
+	return OK;
+    }
+    return FAIL;
+}
+
 /*
  * Compare a number with the operand of RE_LNUM, RE_COL or RE_VCOL.
  */
@@ -5197,6 +5471,7 @@ regdump(char_u *pattern, bt_regprog_T *r)
     int	    op = EXACTLY;	// Arbitrary non-END op.
     char_u  *next;
     char_u  *end = NULL;
+    int	    i;
     FILE    *f;
 
 #ifdef BT_REGEXP_LOG
@@ -5262,8 +5537,9 @@ regdump(char_u *pattern, bt_regprog_T *r)
 		: "multibyte", r->regstart);
     if (r->reganch)
 	fprintf(f, "anchored; ");
-    if (r->regmust != NULL)
-	fprintf(f, "must have \"%s\"", r->regmust);
+    for (i = 0; i < r->regmust.count; ++i)
+	fprintf(f, "%s\"%s\"", i == 0 ? "must have " : " or ",
+							     r->regmust.str[i]);
     fprintf(f, "\r\n");
 
 #ifdef BT_REGEXP_LOG
@@ -263,6 +263,87 @@ static save_se_T *nfa_endp = NULL;
 // 0 for first call to nfa_regmatch(), 1 for recursive call.
 static int nfa_ll_index = 0;
 
+/*
+ * A DFA is built lazily from the NFA states.  It is used to quickly find out
+ * that a line cannot match, so that nfa_regmatch() does not need to be
+ * called.  A DFA state stands for the set of NFA states that was reached
+ * after a character, before following the transitions that don't consume a
+ * character, together with the class of that character.  These transitions
+ * depend on the class of the previous and the current character, which is
+ * needed for "\<" and "\>".
+ * Only characters below 0x80 are handled when 'encoding' is a multibyte
+ * encoding, when another character is found the NFA is used for the line.
+ */
+typedef struct nfa_dfa_state_S nfa_dfa_state_T;
+struct nfa_dfa_state_S
+{
+    nfa_dfa_state_T	*next[256];	// state after a character, NULL when
+					// not computed yet
+    nfa_dfa_state_T	*hash_next;	// next state in the same hash bucket
+    int			ctx;		// DFA_CTX_ value
+    int			nkernel;	// number of items in "kernel"
+    int			kernel[1];	// sorted NFA state indexes, actually
+					// longer
+};
+
+// DFA_CTX_ values: class of the previous character.
+#define DFA_CTX_BOL	0	// at the start of the line
+#define DFA_CTX_WHITE	1	// white space
+#define DFA_CTX_PUNCT	2	// punctuation
+#define DFA_CTX_WORD	3	// word character
+#define DFA_CTX_OTHER	4	// other multibyte class
+#define DFA_CTX_COUNT	5
+
+// Values for use_dfa in nfa_regprog_T.
+#define DFA_NO		0	// pattern cannot be handled by the DFA
+#define DFA_YES		1	// DFA can be used
+#define DFA_KEYWORD	2	// DFA can be used, depends on 'iskeyword'
+
+// Only build a DFA for a pattern with up to this many NFA states.
+#define DFA_MAX_NSTATE	2000
+// Maximum number of DFA states, each takes about 2 Kbyte.
+#define DFA_MAX_STATES	500
+// When the DFA states were thrown away this often, stop using the DFA.
+#define DFA_MAX_FLUSH	20
+#define DFA_HASH_SIZE	64
+
+struct nfa_dfa_S
+{
+    nfa_dfa_state_T	*hash[DFA_HASH_SIZE];
+    nfa_dfa_state_T	*start[DFA_CTX_COUNT];	// states without a kernel
+    int			state_count;	// number of states in "hash"
+    int			flush_count;	// nr of times all states were freed
+    int			reg_ic;		// rex.reg_ic used for the states
+    int			mbyte;		// has_mbyte used for the states
+    char_u		chartab[32];	// 'iskeyword' used for the states
+    int			*mark;		// "markid" when NFA state was seen
+    int			markid;
+    nfa_state_T		**stack;	// work stack, one entry per NFA state
+    nfa_state_T		**list;		// NFA states reached from a kernel
+    int			*kernel;	// kernel being built
+};
+
+// Returned by nfa_dfa_next() when there is a match.
+static nfa_dfa_state_T nfa_dfa_match;
+
+// Max length of a string found by nfa_get_must(), including the NUL.
+#define NFA_MUST_LEN	32
+// Only use nfa_get_must() for a postfix form up to this size.
+#define NFA_MUST_MAX_POST 2000
+
+/*
+ * Item on the stack used by nfa_get_must(), describing what is known about
+ * the text matched by part of the pattern.
+ */
+typedef struct
+{
+    int		exact;		// TRUE: matches exactly one of "str",
+				// FALSE: contains one of "str"
+    int		count;		// number of strings in "str", zero when
+				// nothing is known
+    char_u	str[REG_MUST_MAX][NFA_MUST_LEN];
+} nfa_must_T;
+
 static int realloc_post_list(void);
 static int nfa_reg(int paren);
 #ifdef DEBUG
@@ -504,6 +585,323 @@ nfa_get_match_text(nfa_state_T *start)
     return ret;
 }
 
+/*
+ * Add "str" to the strings in "m", unless it is already there.
+ */
+    static void
+nfa_must_add(nfa_must_T *m, char_u *str)
+{
+    int i;
+
+    for (i = 0; i < m->count; ++i)
+	if (STRCMP(m->str[i], str) == 0)
+	    return;
+    STRCPY(m->str[m->count], str);
+    ++m->count;
+}
+
+/*
+ * Change "m" from the strings it matches exactly into the strings of which
+ * one must appear.
+ */
+    static void
+nfa_must_contains(nfa_must_T *m)
+{
+    int i;
+
+    if (m->exact)
+    {
+	m->exact = FALSE;
+	// When the empty string may match nothing needs to appear.
+	for (i = 0; i < m->count; ++i)
+	    if (m->str[i][0] == NUL)
+		m->count = 0;
+    }
+}
+
+/*
+ * Return how useful the strings in "m" are to skip lines, higher is better.
+ */
+    static int
+nfa_must_score(nfa_must_T *m)
+{
+    int i;
+    int len;
+    int minlen = NFA_MUST_LEN;
+
+    if (m->count == 0)
+	return 0;
+    for (i = 0; i < m->count; ++i)
+    {
+	len = (int)STRLEN(m->str[i]);
+	if (len < minlen)
+	    minlen = len;
+    }
+    // A longer shortest string matters most, then fewer strings.
+    return minlen * (REG_MUST_MAX + 1) - m->count;
+}
+
+/*
+ * Set "a" to what is known about "a" followed by "b".
+ */
+    static void
+nfa_must_concat(nfa_must_T *a, nfa_must_T *b)
+{
+    nfa_must_T	r;
+    char_u	buf[NFA_MUST_LEN * 2];
+    int		i;
+    int		j;
+
+    if (a->exact && b->exact && a->count * b->count <= REG_MUST_MAX)
+    {
+	r.exact = TRUE;
+	r.count = 0;
+	for (i = 0; i < a->count; ++i)
+	    for (j = 0; j < b->count; ++j)
+	    {
+		STRCPY(buf, a->str[i]);
+		STRCAT(buf, b->str[j]);
+		if (STRLEN(buf) >= NFA_MUST_LEN)
+		    goto nocopy;
+		nfa_must_add(&r, buf);
+	    }
+	*a = r;
+	return;
+    }
+
+nocopy:
+    // Either of them must appear, keep the one that skips most lines.
+    // Prefer the later one, since the regstart check works with the start.
+    nfa_must_contains(a);
+    nfa_must_contains(b);
+    if (nfa_must_score(b) >= nfa_must_score(a))
+	*a = *b;
+}
+
+/*
+ * Set "a" to what is known about "a" or "b".
+ */
+    static void
+nfa_must_or(nfa_must_T *a, nfa_must_T *b)
+{
+    int i;
+
+    if (!(a->exact && b->exact))
+    {
+	nfa_must_contains(a);
+	nfa_must_contains(b);
+	if (a->count == 0 || b->count == 0)
+	{
+	    a->count = 0;
+	    return;
+	}
+    }
+    if (a->count + b->count > REG_MUST_MAX)
+    {
+	a->exact = FALSE;
+	a->count = 0;
+	return;
+    }
+    for (i = 0; i < b->count; ++i)
+	nfa_must_add(a, b->str[i]);
+}
+
+/*
+ * Find strings of which one must appear in every match of the postfix form
+ * "postfix" to "end" and store them in "prog->regmust".  Only ASCII
+ * characters are used, so that 'ignorecase' is easy to handle.
+ */
+    static void
+nfa_get_must(nfa_regprog_T *prog, int *postfix, int *end)
+{
+    nfa_must_T	*stack;
+    nfa_must_T	*sp;
+    int		*p;
+    int		n;
+    char_u	*str;
+
+    CLEAR_FIELD(prog->regmust);
+
+    // A line break would make the text continue in the next line.
+    if ((prog->regflags & (RF_HASNL | RF_ICOMBINE))
+					  || end - postfix > NFA_MUST_MAX_POST)
+	return;
+
+    stack = ALLOC_MULT(nfa_must_T, end - postfix + 1);
+    if (stack == NULL)
+	return;
+    sp = stack;
+
+#define MUST_PUSH(e, s)	do {			\
+			    sp->exact = (e);	\
+			    sp->count = 1;	\
+			    STRCPY(sp->str[0], (s)); \
+			    ++sp;		\
+			} while (0)
+#define MUST_PUSH_NONE() do {			\
+			    sp->exact = FALSE;	\
+			    sp->count = 0;	\
+			    ++sp;		\
+			} while (0)
+
+    for (p = postfix; p < end; ++p)
+    {
+	switch (*p)
+	{
+	    case NFA_CONCAT:
+	    case NFA_OR:
+		if (sp - stack < 2)
+		    goto theend;
+		--sp;
+		if (*p == NFA_CONCAT)
+		    nfa_must_concat(sp - 1, sp);
+		else
+		    nfa_must_or(sp - 1, sp);
+		break;
+
+	    case NFA_RANGE:
+		if (sp - stack < 2)
+		    goto theend;
+		--sp;
+		sp[-1].exact = FALSE;
+		sp[-1].count = 0;
+		break;
+
+	    case NFA_STAR:
+	    case NFA_STAR_NONGREEDY:
+	    case NFA_QUEST:
+	    case NFA_QUEST_NONGREEDY:
+	    case NFA_END_COLL:
+	    case NFA_END_NEG_COLL:
+	    case NFA_PREV_ATOM_LIKE_PATTERN:
+		// May match nothing or one of many characters.
+		if (sp == stack)
+		    goto theend;
+		sp[-1].exact = FALSE;
+		sp[-1].count = 0;
+		break;
+
+	    case NFA_OPT_CHARS:
+		n = *++p;
+		if (sp - stack < n)
+		    goto theend;
+		sp -= n;
+		MUST_PUSH_NONE();
+		break;
+
+	    case NFA_PREV_ATOM_JUST_BEFORE:
+	    case NFA_PREV_ATOM_JUST_BEFORE_NEG:
+		++p; // skip the count
+		// FALLTHROUGH
+	    case NFA_PREV_ATOM_NO_WIDTH:
+	    case NFA_PREV_ATOM_NO_WIDTH_NEG:
+		// Zero-width, the text may be before the start column.
+		if (sp == stack)
+		    goto theend;
+		--sp;
+		MUST_PUSH(TRUE, "");
+		break;
+
+	    case NFA_COMPOSING:
+		if (sp > stack)
+		    --sp;
+		MUST_PUSH_NONE();
+		break;
+
+	    case NFA_MOPEN:
+	    case NFA_MOPEN1:
+	    case NFA_MOPEN2:
+	    case NFA_MOPEN3:
+	    case NFA_MOPEN4:
+	    case NFA_MOPEN5:
+	    case NFA_MOPEN6:
+	    case NFA_MOPEN7:
+	    case NFA_MOPEN8:
+	    case NFA_MOPEN9:
+#ifdef FEAT_SYN_HL
+	    case NFA_ZOPEN:
+	    case NFA_ZOPEN1:
+	    case NFA_ZOPEN2:
+	    case NFA_ZOPEN3:
+	    case NFA_ZOPEN4:
+	    case NFA_ZOPEN5:
+	    case NFA_ZOPEN6:
+	    case NFA_ZOPEN7:
+	    case NFA_ZOPEN8:
+	    case NFA_ZOPEN9:
+#endif
+	    case NFA_NOPEN:
+		// Same as in post2nfa(): an empty stack means an empty group.
+		if (sp == stack)
+		    MUST_PUSH(TRUE, "");
+		break;
+
+	    case NFA_LNUM:
+	    case NFA_LNUM_GT:
+	    case NFA_LNUM_LT:
+	    case NFA_VCOL:
+	    case NFA_VCOL_GT:
+	    case NFA_VCOL_LT:
+	    case NFA_COL:
+	    case NFA_COL_GT:
+	    case NFA_COL_LT:
+	    case NFA_MARK:
+	    case NFA_MARK_GT:
+	    case NFA_MARK_LT:
+		++p; // skip the number or mark name
+		// FALLTHROUGH
+	    case NFA_BOL:
+	    case NFA_EOL:
+	    case NFA_BOW:
+	    case NFA_EOW:
+	    case NFA_BOF:
+	    case NFA_EOF:
+	    case NFA_ZSTART:
+	    case NFA_ZEND:
+	    case NFA_CURSOR:
+	    case NFA_VISUAL:
+	    case NFA_EMPTY:
+		MUST_PUSH(TRUE, "");
+		break;
+
+	    case NFA_NEWL:
+		goto theend;
+
+	    default:
+		if (*p >= NFA_FIRST_NL && *p <= NFA_LAST_NL)
+		    goto theend;
+		if (*p > 0 && *p < 0x80)
+		{
+		    char_u  buf[2];
+
+		    buf[0] = *p;
+		    buf[1] = NUL;
+		    MUST_PUSH(TRUE, buf);
+		}
+		else
+		    MUST_PUSH_NONE();
+		break;
+	}
+    }
+
+    if (sp - stack == 1)
+    {
+	nfa_must_contains(stack);
+	for (n = 0; n < stack->count; ++n)
+	{
+	    str = vim_strsave(stack->str[n]);
+	    if (str == NULL)
+		break;
+	    reg_must_add(&prog->regmust, str, (int)STRLEN(str));
+	}
+    }
+
+theend:
+    vim_free(stack);
+#undef MUST_PUSH
+#undef MUST_PUSH_NONE
+}
+
 /*
  * Allocate more space for post_start.  Called when
  * running above the estimated number of states.
@@ -1503,6 +1901,7 @@ nfa_regatom(void)
 		    EMIT(NFA_ZSTART);
 		    if (re_mult_next("\\zs") == FAIL)
 			return FAIL;
+		    regflags |= RF_ZSTART;
 		    break;
 		case 'e':
 		    EMIT(NFA_ZEND);
@@ -5720,6 +6119,113 @@ find_match_text(colnr_T *startcol, int regstart, char_u *match_text)
     return 0L;
 }
 
+// The thread lists and listids used by nfa_regmatch() are kept for the next
+// call, so that matching many lines or strings doesn't allocate and free them
+// every time.  There is one entry for each nesting level of nfa_regmatch(),
+// deeper levels allocate.  Very big lists are not kept.
+#define NFA_POOL_DEPTH	    3
+#define NFA_POOL_MAX_SIZE   (2048 * 1024)
+
+typedef struct
+{
+    nfa_thread_T    *t[2];
+    int		    len[2];
+    int		    *listids;
+    int		    listids_len;
+} nfa_pool_T;
+
+static nfa_pool_T   nfa_pool[NFA_POOL_DEPTH];
+static int	    nfa_pool_depth = 0;
+
+/*
+ * Get the thread lists for nfa_regmatch() with room for "size" states from
+ * "pool", or allocate them when "pool" is NULL or has too small lists.
+ * Also takes the listids from "pool".
+ * Returns FAIL when out of memory.
+ */
+    static int
+nfa_pool_get(
+    nfa_pool_T	*pool,
+    nfa_list_T	*list,
+    int		size,
+    int		**listids,
+    int		*listids_len)
+{
+    int		i;
+
+    for (i = 0; i < 2; ++i)
+    {
+	if (pool != NULL && pool->t[i] != NULL && pool->len[i] >= size)
+	{
+	    list[i].t = pool->t[i];
+	    list[i].len = pool->len[i];
+	    pool->t[i] = NULL;
+	}
+	else
+	{
+	    list[i].t = ALLOC_MULT(nfa_thread_T, size);
+	    list[i].len = size;
+	}
+    }
+    if (pool != NULL)
+    {
+	*listids = pool->listids;
+	*listids_len = pool->listids_len;
+	pool->listids = NULL;
+    }
+    return list[0].t == NULL || list[1].t == NULL ? FAIL : OK;
+}
+
+/*
+ * Put the thread lists and listids used by nfa_regmatch() back in "pool", or
+ * free them when "pool" is NULL or they are too big to keep.
+ */
+    static void
+nfa_pool_put(
+    nfa_pool_T	*pool,
+    nfa_list_T	*list,
+    int		*listids,
+    int		listids_len)
+{
+    int		i;
+
+    for (i = 0; i < 2; ++i)
+    {
+	if (pool != NULL && list[i].t != NULL && (size_t)list[i].len
+			    * sizeof(nfa_thread_T) <= NFA_POOL_MAX_SIZE)
+	{
+	    vim_free(pool->t[i]);
+	    pool->t[i] = list[i].t;
+	    pool->len[i] = list[i].len;
+	}
+	else
+	    vim_free(list[i].t);
+    }
+    if (pool != NULL)
+    {
+	vim_free(pool->listids);
+	pool->listids = listids;
+	pool->listids_len = listids_len;
+    }
+    else
+	vim_free(listids);
+}
+
+#if defined(EXITFREE) || defined(PROTO)
+    static void
+nfa_pool_free(void)
+{
+    int		i;
+
+    for (i = 0; i < NFA_POOL_DEPTH; ++i)
+    {
+	VIM_CLEAR(nfa_pool[i].t[0]);
+	VIM_CLEAR(nfa_pool[i].t[1]);
+	VIM_CLEAR(nfa_pool[i].listids);
+    }
+}
+#endif
+
 /*
  * Main matching routine.
  *
@@ -5741,7 +6247,6 @@ nfa_regmatch(
     regsubs_T		*m)
 {
     int		result = FALSE;
-    size_t	size = 0;
     int		flag = 0;
     int		go_to_nextline = FALSE;
     nfa_thread_T *t;
@@ -5757,6 +6262,7 @@ nfa_regmatch(
     int		add_off = 0;
     int		toplevel = start->c == NFA_MOPEN;
     regsubs_T	*r;
+    nfa_pool_T	*pool;
 #ifdef NFA_REGEXP_DEBUG_LOG
     FILE	*debug;
 #endif
@@ -5781,14 +6287,11 @@ nfa_regmatch(
 #endif
     nfa_match = FALSE;
 
-    // Allocate memory for the lists of nodes.
-    size = (prog->nstate + 1) * sizeof(nfa_thread_T);
-
-    list[0].t = alloc(size);
-    list[0].len = prog->nstate + 1;
-    list[1].t = alloc(size);
-    list[1].len = prog->nstate + 1;
-    if (list[0].t == NULL || list[1].t == NULL)
+    // Get memory for the lists of nodes.
+    pool = nfa_pool_depth < NFA_POOL_DEPTH ? &nfa_pool[nfa_pool_depth] : NULL;
+    ++nfa_pool_depth;
+    if (nfa_pool_get(pool, list, prog->nstate + 1,
+					     &listids, &listids_len) == FAIL)
 	goto theend;
 
 #ifdef ENABLE_LOG
@@ -7274,10 +7777,9 @@ nextchar:
 #endif
 
 theend:
-    // Free memory
-    vim_free(list[0].t);
-    vim_free(list[1].t);
-    vim_free(listids);
+    // Keep or free memory
+    nfa_pool_put(pool, list, listids, listids_len);
+    --nfa_pool_depth;
 #undef ADD_STATE_IF_MATCH
 #ifdef NFA_REGEXP_DEBUG_LOG
     fclose(debug);
@@ -7425,6 +7927,547 @@ nfa_regtry(
     return 1 + rex.lnum;
 }
 
+/*
+ * Return DFA_YES when the DFA can be used to check whether "prog" may match,
+ * DFA_KEYWORD when that depends on 'iskeyword' and DFA_NO otherwise.
+ * Look-around, back references, composing characters and line breaks are
+ * not supported.  Items that depend on the position in the buffer, such as
+ * "\%23l", are skipped, the DFA may then find a match where there is none.
+ */
+    static int
+nfa_dfa_possible(nfa_regprog_T *prog)
+{
+    int		i;
+    int		res = DFA_YES;
+
+    if (prog->nstate > DFA_MAX_NSTATE)
+	return DFA_NO;
+    for (i = 0; i < prog->nstate; ++i)
+    {
+	switch (prog->state[i].c)
+	{
+	    case NFA_BOW:
+	    case NFA_EOW:
+	    case NFA_KWORD:
+	    case NFA_SKWORD:
+	    case NFA_CLASS_KEYWORD:
+		res = DFA_KEYWORD;
+		break;
+
+	    case NFA_SPLIT:
+	    case NFA_MATCH:
+	    case NFA_EMPTY:
+	    case NFA_BOL:
+	    case NFA_EOL:
+	    case NFA_BOF:
+	    case NFA_EOF:
+	    case NFA_ZSTART:
+	    case NFA_ZEND:
+	    case NFA_NOPEN:
+	    case NFA_NCLOSE:
+	    case NFA_START_COLL:
+	    case NFA_START_NEG_COLL:
+	    case NFA_END_COLL:
+	    case NFA_RANGE_MIN:
+	    case NFA_RANGE_MAX:
+	    case NFA_ANY:
+	    case NFA_WHITE:
+	    case NFA_NWHITE:
+	    case NFA_DIGIT:
+	    case NFA_NDIGIT:
+	    case NFA_HEX:
+	    case NFA_NHEX:
+	    case NFA_OCTAL:
+	    case NFA_NOCTAL:
+	    case NFA_WORD:
+	    case NFA_NWORD:
+	    case NFA_HEAD:
+	    case NFA_NHEAD:
+	    case NFA_ALPHA:
+	    case NFA_NALPHA:
+	    case NFA_LOWER:
+	    case NFA_NLOWER:
+	    case NFA_UPPER:
+	    case NFA_NUPPER:
+	    case NFA_LOWER_IC:
+	    case NFA_NLOWER_IC:
+	    case NFA_UPPER_IC:
+	    case NFA_NUPPER_IC:
+	    case NFA_CURSOR:
+	    case NFA_LNUM:
+	    case NFA_LNUM_GT:
+	    case NFA_LNUM_LT:
+	    case NFA_COL:
+	    case NFA_COL_GT:
+	    case NFA_COL_LT:
+	    case NFA_VCOL:
+	    case NFA_VCOL_GT:
+	    case NFA_VCOL_LT:
+	    case NFA_MARK:
+	    case NFA_MARK_GT:
+	    case NFA_MARK_LT:
+	    case NFA_VISUAL:
+	    case NFA_CLASS_ALNUM:
+	    case NFA_CLASS_ALPHA:
+	    case NFA_CLASS_BLANK:
+	    case NFA_CLASS_CNTRL:
+	    case NFA_CLASS_DIGIT:
+	    case NFA_CLASS_GRAPH:
+	    case NFA_CLASS_LOWER:
+	    case NFA_CLASS_PUNCT:
+	    case NFA_CLASS_SPACE:
+	    case NFA_CLASS_UPPER:
+	    case NFA_CLASS_XDIGIT:
+	    case NFA_CLASS_TAB:
+	    case NFA_CLASS_RETURN:
+	    case NFA_CLASS_BACKSPACE:
+	    case NFA_CLASS_ESCAPE:
+		break;
+
+	    default:
+		if ((prog->state[i].c >= NFA_MOPEN
+				      && prog->state[i].c <= NFA_MCLOSE9)
+#ifdef FEAT_SYN_HL
+			|| (prog->state[i].c >= NFA_ZOPEN
+				      && prog->state[i].c <= NFA_ZCLOSE9)
+#endif
+			|| prog->state[i].c >= 0)
+		    break;
+		return DFA_NO;
+	}
+    }
+    return res;
+}
+
+/*
+ * Free all the DFA states of "dfa".
+ */
+    static void
+nfa_dfa_flush(nfa_dfa_T *dfa)
+{
+    nfa_dfa_state_T *ds;
+    int		    i;
+
+    for (i = 0; i < DFA_HASH_SIZE; ++i)
+	while (dfa->hash[i] != NULL)
+	{
+	    ds = dfa->hash[i];
+	    dfa->hash[i] = ds->hash_next;
+	    vim_free(ds);
+	}
+    for (i = 0; i < DFA_CTX_COUNT; ++i)
+	dfa->start[i] = NULL;
+    dfa->state_count = 0;
+}
+
+/*
+ * Free "dfa" and everything it contains.
+ */
+    static void
+nfa_dfa_free(nfa_dfa_T *dfa)
+{
+    if (dfa == NULL)
+	return;
+    nfa_dfa_flush(dfa);
+    vim_free(dfa->mark);
+    vim_free(dfa->stack);
+    vim_free(dfa->list);
+    vim_free(dfa->kernel);
+    vim_free(dfa);
+}
+
+/*
+ * Return the DFA_CTX_ value for a character of class "class", as returned by
+ * mb_get_class_buf().
+ */
+    static int
+nfa_dfa_ctx(int class)
+{
+    if (class < 0)
+	return DFA_CTX_BOL;
+    if (class > 2)
+	return DFA_CTX_OTHER;
+    return DFA_CTX_WHITE + class;
+}
+
+/*
+ * Return the class of character "c", which is below 0x80 or 'encoding' is a
+ * single byte encoding.  Same as what mb_get_class_buf() returns for it.
+ */
+    static int
+nfa_dfa_class(int c)
+{
+    if (c == NUL || VIM_ISWHITE(c))
+	return 0;
+    if (vim_iswordc_buf(c, rex.reg_buf))
+	return 2;
+    return 1;
+}
+
+/*
+ * Find the DFA state with kernel "kernel[nkernel]" and "ctx".  Add it when
+ * it does not exist yet.  When there are too many states all existing
+ * states are freed first.
+ * Returns NULL when out of memory or when the DFA is not to be used anymore.
+ */
+    static nfa_dfa_state_T *
+nfa_dfa_find(nfa_dfa_T *dfa, int *kernel, int nkernel, int ctx)
+{
+    nfa_dfa_state_T *ds;
+    unsigned	    hash = ctx;
+    int		    i;
+
+    if (nkernel == 0 && dfa->start[ctx] != NULL)
+	return dfa->start[ctx];
+
+    for (i = 0; i < nkernel; ++i)
+	hash = hash * 31 + kernel[i];
+    hash &= DFA_HASH_SIZE - 1;
+    for (ds = dfa->hash[hash]; ds != NULL; ds = ds->hash_next)
+	if (ds->ctx == ctx && ds->nkernel == nkernel
+		&& (nkernel == 0
+		    || memcmp(ds->kernel, kernel, nkernel * sizeof(int)) == 0))
+	    return ds;
+
+    if (dfa->state_count >= DFA_MAX_STATES)
+    {
+	// Too many states, start all over.  When this happens often the
+	// pattern is not suitable for a DFA.
+	if (++dfa->flush_count > DFA_MAX_FLUSH)
+	    return NULL;
+	nfa_dfa_flush(dfa);
+    }
+
+    ds = alloc_clear(offsetof(nfa_dfa_state_T, kernel)
+			     + (nkernel == 0 ? 1 : nkernel) * sizeof(int));
+    if (ds == NULL)
+	return NULL;
+    ds->ctx = ctx;
+    ds->nkernel = nkernel;
+    if (nkernel > 0)
+	mch_memmove(ds->kernel, kernel, nkernel * sizeof(int));
+    ds->hash_next = dfa->hash[hash];
+    dfa->hash[hash] = ds;
+    ++dfa->state_count;
+    if (nkernel == 0)
+	dfa->start[ctx] = ds;
+    return ds;
+}
+
+/*
+ * Add NFA state "state" and the states that can be reached from it without
+ * consuming a character to dfa->list[], "*countp" is the number of items.
+ * "ctx" is the class of the previous character, "c" the current character.
+ * Must do the same as addstate() and nfa_regmatch() for these states.
+ */
+    static void
+nfa_dfa_closure(
+    nfa_dfa_T		*dfa,
+    nfa_regprog_T	*prog,
+    nfa_state_T		*state,
+    int			ctx,
+    int			c,
+    int			*countp)
+{
+    int		sp = 0;
+    int		class;
+
+#define DFA_PUSH(s) \
+    if (dfa->mark[(s) - prog->state] != dfa->markid) \
+    { \
+	dfa->mark[(s) - prog->state] = dfa->markid; \
+	dfa->stack[sp++] = (s); \
+    }
+
+    DFA_PUSH(state);
+    while (sp > 0)
+    {
+	state = dfa->stack[--sp];
+	switch (state->c)
+	{
+	    case NFA_SPLIT:
+		DFA_PUSH(state->out1);
+		break;
+
+	    case NFA_BOL:
+		if (ctx != DFA_CTX_BOL)
+		    continue;
+		break;
+
+	    case NFA_EOL:
+		if (c != NUL)
+		    continue;
+		break;
+
+	    case NFA_BOW:
+		class = nfa_dfa_class(c);
+		if (class != 2 || ctx == DFA_CTX_WORD)
+		    continue;
+		break;
+
+	    case NFA_EOW:
+		class = nfa_dfa_class(c);
+		if (ctx != DFA_CTX_OTHER && (ctx != DFA_CTX_WORD || class == 2))
+		    continue;
+		break;
+
+	    case NFA_EMPTY:
+	    case NFA_ZSTART:
+	    case NFA_ZEND:
+	    case NFA_NOPEN:
+	    case NFA_NCLOSE:
+	    case NFA_BOF:
+	    case NFA_EOF:
+	    case NFA_CURSOR:
+	    case NFA_LNUM:
+	    case NFA_LNUM_GT:
+	    case NFA_LNUM_LT:
+	    case NFA_COL:
+	    case NFA_COL_GT:
+	    case NFA_COL_LT:
+	    case NFA_VCOL:
+	    case NFA_VCOL_GT:
+	    case NFA_VCOL_LT:
+	    case NFA_MARK:
+	    case NFA_MARK_GT:
+	    case NFA_MARK_LT:
+	    case NFA_VISUAL:
+		break;
+
+	    default:
+		if ((state->c >= NFA_MOPEN && state->c <= NFA_MCLOSE9)
+#ifdef FEAT_SYN_HL
+			|| (state->c >= NFA_ZOPEN && state->c <= NFA_ZCLOSE9)
+#endif
+		   )
+		    break;
+		// a state that consumes a character or NFA_MATCH
+		dfa->list[(*countp)++] = state;
+		continue;
+	}
+	DFA_PUSH(state->out);
+    }
+#undef DFA_PUSH
+}
+
+/*
+ * Return TRUE if NFA state "state", which consumes a character, matches
+ * character "c", which is not NUL.  Must do the same as nfa_regmatch().
+ */
+    static int
+nfa_dfa_char_match(nfa_state_T *state, int c)
+{
+    switch (state->c)
+    {
+	case NFA_START_COLL:
+	case NFA_START_NEG_COLL:
+	  {
+	    nfa_state_T	*s;
+	    int		result_if_matched = (state->c == NFA_START_COLL);
+	    int		c1, c2;
+
+	    for (s = state->out; s->c != NFA_END_COLL; s = s->out)
+	    {
+		if (s->c == NFA_RANGE_MIN)
+		{
+		    c1 = s->val;
+		    s = s->out; // advance to NFA_RANGE_MAX
+		    c2 = s->val;
+		    if (c >= c1 && c <= c2)
+			return result_if_matched;
+		    if (rex.reg_ic)
+		    {
+			int c_low = MB_CASEFOLD(c);
+
+			for ( ; c1 <= c2; ++c1)
+			    if (MB_CASEFOLD(c1) == c_low)
+				return result_if_matched;
+		    }
+		}
+		else if (s->c < 0 ? check_char_class(s->c, c)
+			   : (c == s->c || (rex.reg_ic
+				       && MB_CASEFOLD(c) == MB_CASEFOLD(s->c))))
+		    return result_if_matched;
+	    }
+	    return !result_if_matched;
+	  }
+
+	case NFA_ANY:	    return TRUE;
+	case NFA_KWORD:	    return vim_iswordc_buf(c, rex.reg_buf);
+	case NFA_SKWORD:    return !VIM_ISDIGIT(c)
+					       && vim_iswordc_buf(c, rex.reg_buf);
+	case NFA_WHITE:	    return VIM_ISWHITE(c);
+	case NFA_NWHITE:    return !VIM_ISWHITE(c);
+	case NFA_DIGIT:	    return ri_digit(c);
+	case NFA_NDIGIT:    return !ri_digit(c);
+	case NFA_HEX:	    return ri_hex(c);
+	case NFA_NHEX:	    return !ri_hex(c);
+	case NFA_OCTAL:	    return ri_octal(c);
+	case NFA_NOCTAL:    return !ri_octal(c);
+	case NFA_WORD:	    return ri_word(c);
+	case NFA_NWORD:	    return !ri_word(c);
+	case NFA_HEAD:	    return ri_head(c);
+	case NFA_NHEAD:	    return !ri_head(c);
+	case NFA_ALPHA:	    return ri_alpha(c);
+	case NFA_NALPHA:    return !ri_alpha(c);
+	case NFA_LOWER:	    return ri_lower(c);
+	case NFA_NLOWER:    return !ri_lower(c);
+	case NFA_UPPER:	    return ri_upper(c);
+	case NFA_NUPPER:    return !ri_upper(c);
+	case NFA_LOWER_IC:  return ri_lower(c) || (rex.reg_ic && ri_upper(c));
+	case NFA_NLOWER_IC: return !(ri_lower(c) || (rex.reg_ic && ri_upper(c)));
+	case NFA_UPPER_IC:  return ri_upper(c) || (rex.reg_ic && ri_lower(c));
+	case NFA_NUPPER_IC: return !(ri_upper(c) || (rex.reg_ic && ri_lower(c)));
+    }
+
+    // regular character
+    return state->c == c
+		  || (rex.reg_ic && MB_CASEFOLD(state->c) == MB_CASEFOLD(c));
+}
+
+    static int
+nfa_dfa_int_cmp(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+/*
+ * Compute the DFA state that follows "ds" for character "c" and store it in
+ * ds->next[c].
+ * Returns &nfa_dfa_match when there is a match before "c".  When "c" is NUL
+ * and there is no match returns "ds".  Returns NULL when the DFA can't be
+ * used.
+ */
+    static nfa_dfa_state_T *
+nfa_dfa_next(nfa_dfa_T *dfa, nfa_regprog_T *prog, nfa_dfa_state_T *ds, int c)
+{
+    nfa_dfa_state_T *next;
+    nfa_state_T	    *s;
+    int		    count = 0;
+    int		    nkernel = 0;
+    int		    flush_count = dfa->flush_count;
+    int		    i;
+
+    if (dfa->markid >= INT_MAX - 2)
+    {
+	vim_memset(dfa->mark, 0, prog->nstate * sizeof(int));
+	dfa->markid = 0;
+    }
+    ++dfa->markid;
+    // The start state is added at every position, the match may start
+    // anywhere.
+    for (i = 0; i < ds->nkernel; ++i)
+	nfa_dfa_closure(dfa, prog, &prog->state[ds->kernel[i]], ds->ctx, c,
+									&count);
+    nfa_dfa_closure(dfa, prog, prog->start, ds->ctx, c, &count);
+
+    next = ds;
+    for (i = 0; i < count; ++i)
+	if (dfa->list[i]->c == NFA_MATCH)
+	    next = &nfa_dfa_match;
+    if (next == ds && c != NUL)
+    {
+	++dfa->markid;
+	for (i = 0; i < count; ++i)
+	{
+	    if (!nfa_dfa_char_match(dfa->list[i], c))
+		continue;
+	    s = dfa->list[i];
+	    if (s->c == NFA_START_COLL || s->c == NFA_START_NEG_COLL)
+		// next state is in out of the NFA_END_COLL
+		s = s->out1->out;
+	    else
+		s = s->out;
+	    if (dfa->mark[s - prog->state] != dfa->markid)
+	    {
+		dfa->mark[s - prog->state] = dfa->markid;
+		dfa->kernel[nkernel++] = (int)(s - prog->state);
+	    }
+	}
+	if (nkernel > 1)
+	    qsort(dfa->kernel, (size_t)nkernel, sizeof(int), nfa_dfa_int_cmp);
+	next = nfa_dfa_find(dfa, dfa->kernel, nkernel,
+						  nfa_dfa_ctx(nfa_dfa_class(c)));
+	if (next == NULL || dfa->flush_count != flush_count)
+	    // "ds" was freed
+	    return next;
+    }
+    ds->next[c] = next;
+    return next;
+}
+
+/*
+ * Use the DFA for "prog" to check whether it may match in "rex.line",
+ * starting at column "col".
+ * Returns FALSE only when there certainly is no match.
+ */
+    static int
+nfa_dfa_may_match(nfa_regprog_T *prog, colnr_T col)
+{
+    nfa_dfa_T	    *dfa = prog->dfa;
+    nfa_dfa_state_T *ds;
+    nfa_dfa_state_T *next;
+    char_u	    *p;
+    int		    c;
+    int		    class = -1;
+
+    if (dfa == NULL)
+    {
+	dfa = ALLOC_CLEAR_ONE(nfa_dfa_T);
+	if (dfa == NULL)
+	    return TRUE;
+	dfa->mark = ALLOC_CLEAR_MULT(int, prog->nstate);
+	dfa->stack = ALLOC_MULT(nfa_state_T *, prog->nstate);
+	dfa->list = ALLOC_MULT(nfa_state_T *, prog->nstate);
+	dfa->kernel = ALLOC_MULT(int, prog->nstate);
+	if (dfa->mark == NULL || dfa->stack == NULL || dfa->list == NULL
+							 || dfa->kernel == NULL)
+	{
+	    nfa_dfa_free(dfa);
+	    return TRUE;
+	}
+	dfa->reg_ic = rex.reg_ic;
+	dfa->mbyte = has_mbyte;
+	mch_memmove(dfa->chartab, rex.reg_buf->b_chartab, 32);
+	prog->dfa = dfa;
+    }
+    if (dfa->flush_count > DFA_MAX_FLUSH)
+	return TRUE;
+
+    // The states depend on 'ignorecase', 'encoding' and 'iskeyword'.
+    if (dfa->reg_ic != rex.reg_ic || dfa->mbyte != has_mbyte
+	    || (prog->use_dfa == DFA_KEYWORD
+		   && memcmp(dfa->chartab, rex.reg_buf->b_chartab, 32) != 0))
+    {
+	nfa_dfa_flush(dfa);
+	dfa->reg_ic = rex.reg_ic;
+	dfa->mbyte = has_mbyte;
+	mch_memmove(dfa->chartab, rex.reg_buf->b_chartab, 32);
+    }
+
+    if (col > 0)
+	class = mb_get_class_buf(rex.line + col - 1
+		       - (*mb_head_off)(rex.line, rex.line + col - 1), rex.reg_buf);
+    ds = nfa_dfa_find(dfa, NULL, 0, nfa_dfa_ctx(class));
+    if (ds == NULL)
+	return TRUE;
+
+    for (p = rex.line + col; ; ++p)
+    {
+	c = *p;
+	if (c >= 0x80 && has_mbyte)
+	    return TRUE;
+	next = ds->next[c];
+	if (next == NULL && (next = nfa_dfa_next(dfa, prog, ds, c)) == NULL)
+	    return TRUE;
+	if (next == &nfa_dfa_match)
+	    return TRUE;
+	if (c == NUL)
+	    return FALSE;
+	ds = next;
+    }
+}
+
 /*
  * Match a regexp against a string ("line" points to the string) or multiple
  * lines (if "line" is NULL, use reg_getline()).
@@ -7527,6 +8570,19 @@ nfa_regexec_both(
     if (rex.reg_maxcol > 0 && col >= rex.reg_maxcol)
 	goto theend;
 
+    // If there are strings of which one must appear, look for them.
+    if (prog->regmust.count > 0 && !rex.reg_icombine
+			      && !reg_must_find(&prog->regmust, line + col))
+	goto theend;
+
+    // Quickly check whether there can be a match in this line at all.
+    if (prog->use_dfa != DFA_NO
+# ifdef FEAT_EVAL
+	    && !nfa_fail_for_testing
+# endif
+	    && !nfa_dfa_may_match(prog, col))
+	goto theend;
+
     // Set the "nstate" used by nfa_regcomp() to zero to trigger an error when
     // it's accidentally used during execution.
     nstate = 0;
@@ -7601,6 +8657,11 @@ nfa_regcomp(char_u *expr, int re_flags)
     if (postfix == NULL)
 	goto fail;	    // Cascaded (syntax?) error
 
+    // Back references are slow, a state has to be kept for every possible
+    // sub-match.  Let the backtracking engine handle them if it can.
+    if ((re_flags & RE_AUTO) && rex.nfa_has_backref && !wants_nfa)
+	goto fail;
+
     /*
      * In order to build the NFA, we parse the input regexp twice:
      * 1. first pass to count size (so we can allocate space)
@@ -7652,6 +8713,9 @@ nfa_regcomp(char_u *expr, int re_flags)
     prog->reganch = nfa_get_reganch(prog->start, 0);
     prog->regstart = nfa_get_regstart(prog->start, 0);
     prog->match_text = nfa_get_match_text(prog->start);
+    nfa_get_must(prog, postfix, post_ptr);
+    prog->use_dfa = nfa_dfa_possible(prog);
+    prog->dfa = NULL;
 
 #ifdef ENABLE_LOG
     nfa_postfix_dump(expr, OK);
@@ -7689,11 +8753,16 @@ fail:
     static void
 nfa_regfree(regprog_T *prog)
 {
+    int i;
+
     if (prog == NULL)
 	return;
 
     vim_free(((nfa_regprog_T *)prog)->match_text);
+    for (i = 0; i < ((nfa_regprog_T *)prog)->regmust.count; ++i)
+	vim_free(((nfa_regprog_T *)prog)->regmust.str[i]);
     vim_free(((nfa_regprog_T *)prog)->pattern);
+    nfa_dfa_free(((nfa_regprog_T *)prog)->dfa);
     vim_free(prog);
 }
 
@@ -7763,6 +8832,49 @@ nfa_regexec_multi(
     return nfa_regexec_both(NULL, col, timed_out);
 }
 
+/*
+ * Check whether "rprog" may match in "line", using only the checks that
+ * nfa_regexec_both() does before running the NFA.
+ * "rex" must have been set up for the buffer.
+ * Returns FALSE when there certainly is no match.
+ */
+    static int
+nfa_regmay_match(regprog_T *rprog, char_u *line)
+{
+    nfa_regprog_T   *prog = (nfa_regprog_T *)rprog;
+    colnr_T	    col = 0;
+
+    rex.line = line;
+    if (prog->regstart != NUL && skip_to_start(prog->regstart, &col) == FAIL)
+	return FALSE;
+    if (prog->regmust.count > 0 && !reg_must_find(&prog->regmust, line + col))
+	return FALSE;
+    if (prog->use_dfa != DFA_NO
+# ifdef FEAT_EVAL
+	    && !nfa_fail_for_testing
+# endif
+	    && !nfa_dfa_may_match(prog, col))
+	return FALSE;
+    return TRUE;
+}
+
+/*
+ * Add the bytes of which one must appear in a line for "rprog" to match in it
+ * to "set".  "ic" is TRUE when ignoring case.
+ * Returns FAIL when this is not known.
+ */
+    static int
+nfa_regneed(regprog_T *rprog, int ic, char_u *set)
+{
+    nfa_regprog_T   *prog = (nfa_regprog_T *)rprog;
+
+    if (prog->regmust.count > 0)
+	return reg_need_add_must(set, &prog->regmust, ic);
+    if (prog->regstart != NUL)
+	return reg_need_add_char(set, prog->regstart, ic);
+    return FAIL;
+}
+
 #ifdef DEBUG
 # undef ENABLE_LOG
 #endif
@@ -692,7 +692,11 @@ searchit(
     int		*timed_out = &unused_timeout_flag;  // set when timed out.
     int		search_from_match_end;		    // vi-compatible search?
 
-    if (search_regcomp(pat, patlen, NULL, RE_SEARCH, pat_use,
+    if (extra_arg != NULL && extra_arg->sa_regmatch != NULL
+				  && extra_arg->sa_regmatch->regprog != NULL)
+	// Use the pattern compiled by a previous call.
+	regmatch = *extra_arg->sa_regmatch;
+    else if (search_regcomp(pat, patlen, NULL, RE_SEARCH, pat_use,
 		   (options & (SEARCH_HIS + SEARCH_KEEP)), &regmatch) == FAIL)
     {
 	if ((options & SEARCH_MSG) && !rc_did_emsg)
@@ -791,6 +795,22 @@ searchit(
 		if (*timed_out)
 		    break;
 
+		// Skip over lines that cannot match, up to where the search
+		// stops.
+		if (dir == FORWARD && !at_first_line)
+		{
+		    linenr_T	lnum_end = buf->b_ml.ml_line_count;
+
+		    if (stop_lnum != 0 && stop_lnum < lnum_end)
+			lnum_end = stop_lnum;
+		    if (loop && start_pos.lnum < lnum_end)
+			lnum_end = start_pos.lnum;
+		    lnum = vim_regexec_multi_skip(&regmatch, win, buf, lnum,
+								    lnum_end);
+		    if (lnum > lnum_end)
+			break;
+		}
+
 		/*
 		 * Look for a match somewhere in line "lnum".
 		 */
@@ -1149,7 +1169,12 @@ searchit(
     if (extra_arg != NULL && extra_arg->sa_tm > 0)
 	disable_regexp_timeout();
 #endif
-    vim_regfree(regmatch.regprog);
+    if (extra_arg != NULL && extra_arg->sa_regmatch != NULL)
+	// The caller frees the program, vim_regexec_multi() may have changed
+	// it.
+	*extra_arg->sa_regmatch = regmatch;
+    else
+	vim_regfree(regmatch.regprog);
 
     if (!found)		    // did not find it
     {
@@ -3309,8 +3334,15 @@ update_search_stat(
 	cur += dirc == 0 ? 0 : dirc == '/' ? 1 : -1;
     else
     {
-	int	done_search = FALSE;
-	pos_T	endpos = {0, 0, 0};
+	int		done_search = FALSE;
+	pos_T		endpos = {0, 0, 0};
+	searchit_arg_T	sia;
+	regmmatch_T	regmatch;
+
+	// Compile the pattern only once for all the matches.
+	CLEAR_FIELD(sia);
+	regmatch.regprog = NULL;
+	sia.sa_regmatch = &regmatch;
 
 	p_ws = FALSE;
 #ifdef FEAT_RELTIME
@@ -3318,7 +3350,7 @@ update_search_stat(
 	    profile_setlimit(timeout, &start);
 #endif
 	while (!got_int && searchit(curwin, curbuf, &lastpos, &endpos,
-			 FORWARD, NULL, 0, 1, SEARCH_KEEP, RE_LAST, NULL) != FAIL)
+			 FORWARD, NULL, 0, 1, SEARCH_KEEP, RE_LAST, &sia) != FAIL)
 	{
 	    done_search = TRUE;
 #ifdef FEAT_RELTIME
@@ -3343,6 +3375,7 @@ update_search_stat(
 		break;
 	    }
 	}
+	vim_regfree(regmatch.regprog);
 	if (got_int)
 	    cur = -1; // abort
 	if (done_search)
@@ -505,6 +505,9 @@ struct m_info
 typedef struct block_hdr    bhdr_T;
 typedef struct memfile	    memfile_T;
 typedef long		    blocknr_T;
+#ifdef HAVE_AIO
+typedef struct mf_aio_S    mf_aio_T;
+#endif
 
 /*
  * mf_hashtab_T is a chained hashtable with blocknr_T key and arbitrary
@@ -544,6 +547,10 @@ typedef struct mf_hashtab_S
  * The used list is a doubly linked list, most recently used block first.
  *	The blocks in the used list have a block of memory allocated.
  *	mf_used_count is the number of pages in the used list.
+ *	Blocks that were read from the file and not used again since then are
+ *	"cold", they are kept at the end of the used list, starting at
+ *	mf_cold_first.  They are released before the other blocks, so that
+ *	going over all lines once does not push out the blocks in use.
  * The hash lists are used to quickly find a block in the used list.
  * The free list is a single linked list, not sorted.
  *	The blocks in the free list have no block of memory allocated and
@@ -562,7 +569,8 @@ struct block_hdr
 
 #define BH_DIRTY    1
 #define BH_LOCKED   2
-    char	bh_flags;	    // BH_DIRTY or BH_LOCKED
+#define BH_COLD	    4		    // in the cold part of the used list
+    char	bh_flags;	    // BH_DIRTY, BH_LOCKED and BH_COLD
 };
 
 /*
@@ -760,7 +768,9 @@ struct memfile
     bhdr_T	*mf_free_first;		// first block_hdr in free list
     bhdr_T	*mf_used_first;		// mru block_hdr in used list
     bhdr_T	*mf_used_last;		// lru block_hdr in used list
+    bhdr_T	*mf_cold_first;		// first cold block_hdr in used list
     unsigned	mf_used_count;		// number of pages in used list
+    unsigned	mf_cold_count;		// number of pages in cold blocks
     unsigned	mf_used_count_max;	// maximum number of pages in memory
     mf_hashtab_T mf_hash;		// hash lists
     mf_hashtab_T mf_trans;		// trans lists
@@ -770,6 +780,15 @@ struct memfile
     blocknr_T	mf_infile_count;	// number of pages in the file
     unsigned	mf_page_size;		// number of bytes in a page
     mfdirty_T	mf_dirty;
+    int		mf_pin_count;		// lines pinned with ml_pin_line(), no
+					// block is released while non-zero
+    int		mf_keep_dirty;		// don't write changed blocks when
+					// releasing them, used with a journal
+    int		mf_need_checkpoint;	// a changed block could not be
+					// released because of mf_keep_dirty
+#ifdef HAVE_AIO
+    mf_aio_T	*mf_aio;		// background writes not finished yet
+#endif
 #ifdef FEAT_CRYPT
     buf_T	*mf_buffer;		// buffer this memfile is for
     char_u	mf_seed[MF_SEED_LEN];	// seed for encryption
@@ -813,6 +832,20 @@ typedef struct ml_chunksize
 # define ML_CHNK_UPDLINE 3
 #endif
 
+/*
+ * Journal of changes for a swap file, see ml_journal_add().  Between
+ * checkpoints the swap file is not written, changes are appended to the
+ * journal.
+ */
+typedef struct
+{
+    int		mj_fd;		// file descriptor of the journal file
+    char_u	*mj_fname;	// name of the journal file
+    off_T	mj_size;	// number of bytes in the journal file
+    garray_T	mj_pending;	// records not written to the file yet
+    int		mj_full;	// too many changes, need a checkpoint
+} mljournal_T;
+
 /*
  * the memline structure holds all the information about a memline
  */
@@ -842,10 +875,13 @@ typedef struct memline
     linenr_T	ml_locked_low;	// first line in ml_locked
     linenr_T	ml_locked_high;	// last line in ml_locked
     int		ml_locked_lineadd;  // number of lines inserted in ml_locked
+    mljournal_T	*ml_journal;	// journal for the swap file or NULL
 #ifdef FEAT_BYTEOFF
     chunksize_T *ml_chunksize;
     int		ml_numchunks;
     int		ml_usedchunks;
+    chunksize_T *ml_chunktree;	// Fenwick tree of ml_chunksize, NULL when it
+				// has to be built
 #endif
 } memline_T;
 
@@ -3060,6 +3096,10 @@ typedef struct {
      * b_sst_freecount	number of free entries in b_sst_array[]
      * b_sst_check_lnum	entries after this lnum need to be checked for
      *			validity (MAXLNUM means no check needed)
+     * b_sst_idle_lnum	lines before this one were parsed while waiting for
+     *			a typed character, see syntax_idle_parse()
+     * b_sst_cache	states read from the undo file, not used yet
+     * b_sst_cache_len	number of bytes in b_sst_cache
      */
     synstate_T	*b_sst_array;
     int		b_sst_len;
@@ -3068,6 +3108,11 @@ typedef struct {
     int		b_sst_freecount;
     linenr_T	b_sst_check_lnum;
     short_u	b_sst_lasttick;	// last display tick
+    linenr_T	b_sst_idle_lnum;
+# ifdef FEAT_PERSISTENT_UNDO
+    char_u	*b_sst_cache;
+    size_t	b_sst_cache_len;
+# endif
 #endif // FEAT_SYN_HL
 
 #ifdef FEAT_SPELL
@@ -3130,6 +3175,8 @@ struct file_buffer
     int		b_dev_valid;	// TRUE when b_dev has a valid number
     dev_t	b_dev;		// device number
     ino_t	b_ino;		// inode number
+    buf_T	*b_index_name_next; // next buffer in buf_index_name bucket
+    buf_T	*b_index_ino_next;  // next buffer in buf_index_ino bucket
 #endif
 #ifdef VMS
     char	 b_fab_rfm;	// Record format
@@ -4965,6 +5012,8 @@ typedef struct
     int		sa_timed_out;	// set when timed out
 #endif
     int		sa_wrapped;	// search wrapped around
+    regmmatch_T	*sa_regmatch;	// compiled pattern to use and keep when
+				// not NULL, compiled when "regprog" is NULL
 } searchit_arg_T;
 
 /*
@@ -56,6 +56,14 @@ typedef struct syn_pattern
     int		 sp_sync_idx;		// sync item index (syncing only)
     int		 sp_line_id;		// ID of last line where tried
     int		 sp_startcol;		// next match in sp_line_id line
+    int		 sp_m_reuse;		// TRUE when the match below can be
+					// used again in sp_line_id line
+    colnr_T	 sp_m_col;		// column where matching started
+    lpos_T	 sp_m_startpos;		// start of the match
+    lpos_T	 sp_m_endpos;		// end of the match
+    int		 sp_need_ok;		// TRUE when sp_need[] is valid
+    char_u	 sp_need[32];		// bytes of which one must be in the
+					// line for a match, one bit each
     short	*sp_cont_list;		// cont. group IDs, if non-zero
     short	*sp_next_list;		// next group IDs, if non-zero
     struct sp_syn sp_syn;		// struct passed to in_id_list()
@@ -274,6 +282,10 @@ static garray_T current_state		// current stack of state_items
 static short	*current_next_list = NULL; // when non-zero, nextgroup list
 static int	current_next_flags = 0; // flags for current_next_list
 static int	current_line_id = 0;	// unique number for current line
+static int	current_bytes_line_id = 0; // current_line_id and lnum for
+static linenr_T	current_bytes_lnum = 0;	   // current_bytes[]
+static char_u	current_bytes[32];	// bytes in the current line, one bit
+					// each
 
 #define CUR_STATE(idx)	((stateitem_T *)(current_state.ga_data))[idx]
 
@@ -284,6 +296,9 @@ static void syn_update_ends(int startofline);
 static void syn_stack_alloc(void);
 static int syn_stack_cleanup(void);
 static void syn_stack_free_entry(synblock_T *block, synstate_T *p);
+#ifdef FEAT_PERSISTENT_UNDO
+static void syn_stack_load_cache(void);
+#endif
 static synstate_T *syn_stack_find_entry(linenr_T lnum);
 static synstate_T *store_current_state(void);
 static void load_current_state(synstate_T *from);
@@ -323,6 +338,7 @@ static void syn_add_start_off(lpos_T *result, regmmatch_T *regmatch, synpat_T *s
 static char_u *syn_getcurline(void);
 static colnr_T syn_getcurline_len(void);
 static int syn_regexec(regmmatch_T *rmp, linenr_T lnum, colnr_T col, syn_time_T *st);
+static int syn_line_may_match(synpat_T *spp);
 static int check_keyword_id(char_u *line, int startcol, int *endcol, long *flags, short **next_list, stateitem_T *cur_si, int *ccharp);
 static void syn_remove_pattern(synblock_T *block, int idx);
 static void syn_clear_pattern(synblock_T *block, int i);
@@ -392,6 +408,10 @@ syntax_start(win_T *wp, linenr_T lnum)
     if (syn_block->b_sst_array == NULL)
 	return;		// out of memory
     syn_block->b_sst_lasttick = display_tick;
+#ifdef FEAT_PERSISTENT_UNDO
+    if (syn_block->b_sst_cache != NULL)
+	syn_stack_load_cache();
+#endif
 
     /*
      * If the state of the end of the previous line is useful, store it.
@@ -528,6 +548,89 @@ syntax_start(win_T *wp, linenr_T lnum)
     syn_start_line();
 }
 
+#define SYN_IDLE_LINES	50	// lines parsed per syntax_start() call
+
+/*
+ * Return TRUE when syntax_idle_parse() has work to do for the current window.
+ * This is only done with "syn sync fromstart": redrawing a line far down the
+ * buffer then requires parsing all lines before it.  Other sync methods only
+ * look back a limited number of lines.
+ * Not done when there are changes that were not applied to b_sst_array[] yet,
+ * that happens when redrawing.
+ */
+    int
+syntax_idle_pending(void)
+{
+    synblock_T	*block = curwin->w_s;
+
+    return (State & (MODE_NORMAL | MODE_INSERT))
+	    && !updating_screen
+	    && !got_int
+	    && !curbuf->b_mod_set
+	    && block->b_sst_array != NULL
+#ifdef SYN_TIME_LIMIT
+	    && !block->b_syn_slow
+#endif
+	    && block->b_syn_sync_minlines == MAXLNUM
+	    && block->b_sst_idle_lnum < curbuf->b_ml.ml_line_count
+	    && syntax_present(curwin);
+}
+
+/*
+ * Called while waiting for a typed character: parse the syntax of the current
+ * window further down the buffer and store states in b_sst_array[] on the
+ * way, so that jumping to another line, e.g. with "G", does not have to parse
+ * everything before it.  Returns after about SYN_IDLE_MSEC msec, the caller
+ * should check for typed characters and call again.
+ */
+    void
+syntax_idle_parse(void)
+{
+    synblock_T	*block = curwin->w_s;
+    linenr_T	lnum;
+#ifdef FEAT_RELTIME
+    proftime_T	tm;
+
+    profile_setlimit(SYN_IDLE_MSEC, &tm);
+#endif
+#ifdef SYN_TIME_LIMIT
+    // Like when redrawing, a pattern that takes longer than 'redrawtime'
+    // sets b_syn_slow and disables syntax highlighting.
+    redrawtime_limit_set = TRUE;
+    init_regexp_timeout(p_rdt);
+#endif
+
+    while (syntax_idle_pending())
+    {
+	lnum = block->b_sst_idle_lnum + SYN_IDLE_LINES;
+	if (lnum > curbuf->b_ml.ml_line_count)
+	    lnum = curbuf->b_ml.ml_line_count;
+	syntax_start(curwin, lnum);
+	if (got_int
+#ifdef SYN_TIME_LIMIT
+		|| block->b_syn_slow
+#endif
+		)
+	{
+	    // Interrupted or timed out, the current state is wrong.
+	    invalidate_current_state();
+	    break;
+	}
+	block->b_sst_idle_lnum = lnum;
+#ifdef FEAT_RELTIME
+	if (profile_passed_limit(&tm))
+	    break;
+#else
+	break;
+#endif
+    }
+
+#ifdef SYN_TIME_LIMIT
+    disable_regexp_timeout();
+    redrawtime_limit_set = FALSE;
+#endif
+}
+
 /*
  * We cannot simply discard growarrays full of state_items or buf_states; we
  * have to manually release their extmatch pointers first.
@@ -1035,6 +1138,7 @@ syn_stack_free_block(synblock_T *block)
     VIM_CLEAR(block->b_sst_array);
     block->b_sst_first = NULL;
     block->b_sst_len = 0;
+    block->b_sst_idle_lnum = 0;
 }
 /*
  * Free b_sst_array[] for buffer "buf".
@@ -1164,6 +1268,14 @@ syn_stack_apply_changes_block(synblock_T *block, buf_T *buf)
     synstate_T	*p, *prev, *np;
     linenr_T	n;
 
+    // Lines from the change onwards need to be parsed again.
+    if (block->b_sst_idle_lnum > buf->b_mod_top)
+	block->b_sst_idle_lnum = buf->b_mod_top;
+#ifdef FEAT_PERSISTENT_UNDO
+    // States read from the undo file are for the text before the change.
+    syn_stack_free_cache(block);
+#endif
+
     prev = NULL;
     for (p = block->b_sst_first; p != NULL; )
     {
@@ -1300,6 +1412,395 @@ syn_stack_find_entry(linenr_T lnum)
     return prev;
 }
 
+#if defined(FEAT_PERSISTENT_UNDO) || defined(PROTO)
+/*
+ * The states in b_sst_array[] can be stored in the undo file, so that after
+ * editing the file again highlighting can start from them.  They can only be
+ * used when the text is the same, this is checked with the hash of the text
+ * in the undo file, and when the syntax items are the same, this is checked
+ * with a hash computed by syn_hash_block().
+ *
+ * Format of the stored states, all numbers are four bytes, MSB first:
+ *	hash of the syntax items (SYN_HASH_SIZE bytes)
+ *	number of states
+ *	for each state:
+ *	    line number
+ *	    stack size
+ *	    for each stack entry: pattern index + 1, flags, seqnr, cchar
+ */
+# define SYN_HASH_SIZE	32
+# define SYN_CACHE_NR	4	// bytes per number
+
+    static void
+syn_hash_nr(context_sha256_T *ctx, long nr)
+{
+    char_u	buf[SYN_CACHE_NR];
+    int		i;
+
+    for (i = SYN_CACHE_NR - 1; i >= 0; --i)
+    {
+	buf[i] = (char_u)(nr & 0xff);
+	nr >>= 8;
+    }
+    sha256_update(ctx, buf, SYN_CACHE_NR);
+}
+
+    static void
+syn_hash_str(context_sha256_T *ctx, char_u *s)
+{
+    if (s == NULL)
+	s = (char_u *)"";
+    sha256_update(ctx, s, (UINT32_T)STRLEN(s) + 1);
+}
+
+/*
+ * Add a group or cluster ID to the hash.  The names are used, the IDs
+ * depend on what highlight groups were defined before.
+ */
+    static void
+syn_hash_id(context_sha256_T *ctx, synblock_T *block, int id)
+{
+    if (id >= SYNID_CLUSTER)
+    {
+	syn_hash_nr(ctx, SYNID_CLUSTER);
+	if (id - SYNID_CLUSTER < block->b_syn_clusters.ga_len)
+	    syn_hash_str(ctx, SYN_CLSTR(block)[id - SYNID_CLUSTER].scl_name);
+    }
+    else if (id >= SYNID_ALLBUT || id <= 0 || id > highlight_num_groups())
+	syn_hash_nr(ctx, id);
+    else
+	syn_hash_str(ctx, highlight_group_name(id - 1));
+}
+
+    static void
+syn_hash_id_list(context_sha256_T *ctx, synblock_T *block, short *list)
+{
+    if (list != NULL)
+	for ( ; *list != 0; ++list)
+	    syn_hash_id(ctx, block, *list);
+    syn_hash_nr(ctx, 0);
+}
+
+/*
+ * Compute a hash of everything in "block" that the syntax states depend on
+ * into "hash[SYN_HASH_SIZE]".
+ */
+    static void
+syn_hash_block(synblock_T *block, buf_T *buf, char_u *hash)
+{
+    context_sha256_T	ctx;
+    context_sha256_T	kctx;
+    char_u		keyw_sum[SYN_HASH_SIZE];
+    char_u		keyw_hash[SYN_HASH_SIZE];
+    synpat_T		*spp;
+    syn_cluster_T	*scp;
+    hashtab_T		*ht;
+    hashitem_T		*hi;
+    keyentry_T		*kp;
+    int			todo;
+    int			i, j;
+
+    sha256_start(&ctx);
+    syn_hash_nr(&ctx, block->b_syn_patterns.ga_len);
+    for (i = 0; i < block->b_syn_patterns.ga_len; ++i)
+    {
+	spp = &(SYN_ITEMS(block)[i]);
+	syn_hash_nr(&ctx, spp->sp_type);
+	syn_hash_nr(&ctx, spp->sp_syncing);
+	syn_hash_nr(&ctx, spp->sp_flags);
+	syn_hash_nr(&ctx, spp->sp_ic);
+	syn_hash_nr(&ctx, spp->sp_off_flags);
+	for (j = 0; j < SPO_COUNT; ++j)
+	    syn_hash_nr(&ctx, spp->sp_offsets[j]);
+	syn_hash_nr(&ctx, spp->sp_sync_idx);
+	syn_hash_nr(&ctx, spp->sp_syn.inc_tag);
+	syn_hash_id(&ctx, block, spp->sp_syn.id);
+	syn_hash_id(&ctx, block, spp->sp_syn_match_id);
+	syn_hash_str(&ctx, spp->sp_pattern);
+	syn_hash_id_list(&ctx, block, spp->sp_cont_list);
+	syn_hash_id_list(&ctx, block, spp->sp_next_list);
+	syn_hash_id_list(&ctx, block, spp->sp_syn.cont_in_list);
+    }
+
+    syn_hash_nr(&ctx, block->b_syn_clusters.ga_len);
+    for (i = 0; i < block->b_syn_clusters.ga_len; ++i)
+    {
+	scp = &(SYN_CLSTR(block)[i]);
+	syn_hash_str(&ctx, scp->scl_name);
+	syn_hash_id_list(&ctx, block, scp->scl_list);
+    }
+
+    // The order of keywords in the hashtables may differ, add them up so
+    // that the order doesn't matter.
+    CLEAR_FIELD(keyw_sum);
+    for (i = 0; i < 2; ++i)
+    {
+	ht = i == 0 ? &block->b_keywtab : &block->b_keywtab_ic;
+	todo = (int)ht->ht_used;
+	FOR_ALL_HASHTAB_ITEMS(ht, hi, todo)
+	{
+	    if (HASHITEM_EMPTY(hi))
+		continue;
+	    --todo;
+	    for (kp = HI2KE(hi); kp != NULL; kp = kp->ke_next)
+	    {
+		sha256_start(&kctx);
+		syn_hash_nr(&kctx, i);
+		syn_hash_str(&kctx, kp->keyword);
+		syn_hash_id(&kctx, block, kp->k_syn.id);
+		syn_hash_nr(&kctx, kp->k_syn.inc_tag);
+		syn_hash_nr(&kctx, kp->flags);
+		syn_hash_nr(&kctx, kp->k_char);
+		syn_hash_id_list(&kctx, block, kp->next_list);
+		syn_hash_id_list(&kctx, block, kp->k_syn.cont_in_list);
+		sha256_finish(&kctx, keyw_hash);
+		for (j = 0; j < SYN_HASH_SIZE; ++j)
+		    keyw_sum[j] += keyw_hash[j];
+	    }
+	}
+    }
+    sha256_update(&ctx, keyw_sum, SYN_HASH_SIZE);
+
+    syn_hash_nr(&ctx, block->b_syn_ic);
+    syn_hash_nr(&ctx, block->b_syn_containedin);
+    syn_hash_nr(&ctx, block->b_syn_sync_flags);
+    syn_hash_id(&ctx, block, block->b_syn_sync_id);
+    syn_hash_nr(&ctx, block->b_syn_sync_minlines);
+    syn_hash_nr(&ctx, block->b_syn_sync_maxlines);
+    syn_hash_nr(&ctx, block->b_syn_sync_linebreaks);
+    syn_hash_str(&ctx, block->b_syn_linecont_pat);
+    syn_hash_nr(&ctx, block->b_syn_linecont_ic);
+    if (block->b_syn_isk != empty_option)
+	syn_hash_str(&ctx, block->b_syn_isk);
+    else
+	syn_hash_str(&ctx, buf->b_p_isk);
+    syn_hash_nr(&ctx, buf->b_p_smc);
+    sha256_finish(&ctx, hash);
+}
+
+    static void
+syn_cache_put_nr(garray_T *gap, long nr)
+{
+    int		i;
+
+    for (i = SYN_CACHE_NR - 1; i >= 0; --i)
+	ga_append(gap, (int)((nr >> (i * 8)) & 0xff));
+}
+
+/*
+ * Get a number from the stored states at "*pp", advance "*pp".
+ * Returns -1 when there are not enough bytes before "end".
+ */
+    static long
+syn_cache_get_nr(char_u **pp, char_u *end)
+{
+    long	nr = 0;
+    int		i;
+
+    if (end - *pp < SYN_CACHE_NR)
+	return -1;
+    for (i = 0; i < SYN_CACHE_NR; ++i)
+	nr = (nr << 8) + *(*pp)++;
+    return nr;
+}
+
+/*
+ * Return the states in b_sst_array[] of buffer "buf" in allocated memory, to
+ * be stored in the undo file.  The length is stored in "*lenp".
+ * States that depend on something that can't be stored are skipped: a
+ * "nextgroup" or external matches.
+ * Returns NULL when there is nothing to store.
+ */
+    char_u *
+syn_stack_get_cache(buf_T *buf, size_t *lenp)
+{
+    synblock_T	*block = &buf->b_s;
+    garray_T	ga;
+    synstate_T	*p;
+    bufstate_T	*bp;
+    char_u	hash[SYN_HASH_SIZE];
+    int		count = 0;
+    int		count_idx;
+    int		i;
+
+    // States are only right for the text when the changes were applied.
+    if (block->b_sst_array == NULL || buf->b_mod_set)
+	return NULL;
+
+    ga_init2(&ga, 1, 1000);
+    syn_hash_block(block, buf, hash);
+    for (i = 0; i < SYN_HASH_SIZE; ++i)
+	ga_append(&ga, hash[i]);
+    count_idx = ga.ga_len;
+    syn_cache_put_nr(&ga, 0);
+
+    FOR_ALL_SYNSTATES(block, p)
+    {
+	if (p->sst_change_lnum != 0 || p->sst_next_list != NULL
+				    || p->sst_lnum > buf->b_ml.ml_line_count)
+	    continue;
+	if (p->sst_stacksize > SST_FIX_STATES)
+	    bp = SYN_STATE_P(&(p->sst_union.sst_ga));
+	else
+	    bp = p->sst_union.sst_stack;
+	for (i = 0; i < p->sst_stacksize; ++i)
+	    if (bp[i].bs_extmatch != NULL)
+		break;
+	if (i < p->sst_stacksize)
+	    continue;
+
+	syn_cache_put_nr(&ga, p->sst_lnum);
+	syn_cache_put_nr(&ga, p->sst_stacksize);
+	for (i = 0; i < p->sst_stacksize; ++i)
+	{
+	    syn_cache_put_nr(&ga, bp[i].bs_idx + 1);
+	    syn_cache_put_nr(&ga, bp[i].bs_flags);
+#ifdef FEAT_CONCEAL
+	    syn_cache_put_nr(&ga, bp[i].bs_seqnr);
+	    syn_cache_put_nr(&ga, bp[i].bs_cchar);
+#else
+	    syn_cache_put_nr(&ga, 0);
+	    syn_cache_put_nr(&ga, 0);
+#endif
+	}
+	++count;
+    }
+
+    if (count == 0)
+    {
+	ga_clear(&ga);
+	return NULL;
+    }
+    *lenp = (size_t)ga.ga_len;
+    ga.ga_len = count_idx;
+    syn_cache_put_nr(&ga, count);
+    return (char_u *)ga.ga_data;
+}
+
+/*
+ * Remember the states read from the undo file for buffer "buf", takes over
+ * the allocated "data".  They are used by syntax_start() when the syntax
+ * items are the same as when they were stored.
+ */
+    void
+syn_stack_set_cache(buf_T *buf, char_u *data, size_t len)
+{
+    syn_stack_free_cache(&buf->b_s);
+    buf->b_s.b_sst_cache = data;
+    buf->b_s.b_sst_cache_len = len;
+}
+
+    void
+syn_stack_free_cache(synblock_T *block)
+{
+    VIM_CLEAR(block->b_sst_cache);
+    block->b_sst_cache_len = 0;
+}
+
+/*
+ * Fill the still empty b_sst_array[] of syn_buf with the states read from the
+ * undo file, if the syntax items are the same.  The states are used only once.
+ * When the text was changed syn_stack_apply_changes_block() already dropped
+ * them, or the change was not applied yet and b_mod_set is still set.
+ */
+    static void
+syn_stack_load_cache(void)
+{
+    char_u	*p = syn_block->b_sst_cache;
+    char_u	*end = p + syn_block->b_sst_cache_len;
+    char_u	*q;
+    char_u	hash[SYN_HASH_SIZE];
+    synstate_T	*sp;
+    synstate_T	*last = NULL;
+    bufstate_T	*bp;
+    long	count;
+    long	lnum;
+    long	size;
+    long	idx;
+    int		i;
+
+    if (syn_block->b_sst_first == NULL
+	    && !syn_buf->b_mod_set
+	    && end - p >= SYN_HASH_SIZE)
+    {
+	syn_hash_block(syn_block, syn_buf, hash);
+	if (memcmp(p, hash, SYN_HASH_SIZE) == 0)
+	{
+	    p += SYN_HASH_SIZE;
+	    count = syn_cache_get_nr(&p, end);
+	    while (count-- > 0 && syn_block->b_sst_freecount > 0)
+	    {
+		lnum = syn_cache_get_nr(&p, end);
+		size = syn_cache_get_nr(&p, end);
+		if (lnum <= (last == NULL ? 0 : last->sst_lnum)
+			|| lnum > syn_buf->b_ml.ml_line_count
+			|| size < 0
+			|| size > (end - p) / (4 * SYN_CACHE_NR))
+		    break;  // invalid, ignore the rest
+		q = p;
+		for (i = 0; i < size; ++i)
+		{
+		    idx = syn_cache_get_nr(&q, end) - 1;
+		    if (idx < KEYWORD_IDX
+				  || idx >= syn_block->b_syn_patterns.ga_len)
+			break;
+		    q += 3 * SYN_CACHE_NR;
+		}
+		if (i < size)
+		    break;
+
+		// Take the first item from the free list.
+		sp = syn_block->b_sst_firstfree;
+		syn_block->b_sst_firstfree = sp->sst_next;
+		--syn_block->b_sst_freecount;
+		sp->sst_stacksize = size;
+		if (size > SST_FIX_STATES)
+		{
+		    ga_init2(&sp->sst_union.sst_ga, sizeof(bufstate_T), 1);
+		    if (ga_grow(&sp->sst_union.sst_ga, size) == FAIL)
+		    {
+			sp->sst_stacksize = 0;
+			syn_stack_free_entry(syn_block, sp);
+			break;
+		    }
+		    sp->sst_union.sst_ga.ga_len = size;
+		    bp = SYN_STATE_P(&(sp->sst_union.sst_ga));
+		}
+		else
+		    bp = sp->sst_union.sst_stack;
+		for (i = 0; i < size; ++i)
+		{
+		    bp[i].bs_idx = syn_cache_get_nr(&p, end) - 1;
+		    bp[i].bs_flags = syn_cache_get_nr(&p, end);
+#ifdef FEAT_CONCEAL
+		    bp[i].bs_seqnr = syn_cache_get_nr(&p, end);
+		    bp[i].bs_cchar = syn_cache_get_nr(&p, end);
+#else
+		    p += 2 * SYN_CACHE_NR;
+#endif
+		    bp[i].bs_extmatch = NULL;
+		}
+		sp->sst_lnum = lnum;
+		sp->sst_next_list = NULL;
+		sp->sst_next_flags = 0;
+		sp->sst_tick = display_tick;
+		sp->sst_change_lnum = 0;
+		sp->sst_next = NULL;
+		if (last == NULL)
+		    syn_block->b_sst_first = sp;
+		else
+		    last->sst_next = sp;
+		last = sp;
+	    }
+	    if (last != NULL)
+		// Nothing to parse while idle before the last state.
+		syn_block->b_sst_idle_lnum = last->sst_lnum;
+	}
+    }
+    syn_stack_free_cache(syn_block);
+}
+#endif
+
 /*
  * Try saving the current state in b_sst_array[].
  * The current state must be valid for the start of the current_lnum line!
@@ -1953,19 +2454,62 @@ syn_current_attr(
 			    if (spp->sp_line_id == current_line_id
 				    && spp->sp_startcol >= next_match_col)
 				continue;
-			    spp->sp_line_id = current_line_id;
 
 			    lc_col = current_col - spp->sp_offsets[SPO_LC_OFF];
 			    if (lc_col < 0)
 				lc_col = 0;
 
-			    regmatch.rmm_ic = spp->sp_ic;
-			    regmatch.regprog = spp->sp_prog;
-			    r = syn_regexec(&regmatch,
-					     current_lnum,
-					     (colnr_T)lc_col,
-					     IF_SYN_TIME(&spp->sp_time));
-			    spp->sp_prog = regmatch.regprog;
+			    // When the match found before in this line does
+			    // not start before "lc_col" it is still the first
+			    // match, no need to match again.  Another item
+			    // may have matched in between, with many items in
+			    // one line this avoids matching them all again
+			    // and again.
+			    if (spp->sp_line_id == current_line_id
+				    && spp->sp_m_reuse
+				    && spp->sp_m_col <= lc_col
+				    && spp->sp_m_startpos.lnum == current_lnum
+				    && spp->sp_m_startpos.col >= lc_col)
+			    {
+				regmatch.startpos[0] = spp->sp_m_startpos;
+				regmatch.endpos[0] = spp->sp_m_endpos;
+				r = TRUE;
+				// The item has no external submatches, drop
+				// any left by another pattern that matched.
+				unref_extmatch(re_extmatch_out);
+				re_extmatch_out = NULL;
+			    }
+			    else if (!syn_line_may_match(spp))
+			    {
+				r = FALSE;
+				spp->sp_m_reuse = FALSE;
+#ifdef FEAT_PROFILE
+				// still counts as a try for ":syntime"
+				if (syn_time_on)
+				    ++spp->sp_time.count;
+#endif
+			    }
+			    else
+			    {
+				regmatch.rmm_ic = spp->sp_ic;
+				regmatch.regprog = spp->sp_prog;
+				r = syn_regexec(&regmatch,
+						current_lnum,
+						(colnr_T)lc_col,
+						IF_SYN_TIME(&spp->sp_time));
+				spp->sp_prog = regmatch.regprog;
+
+				// Can't use the match again when it has
+				// external submatches, or when "\zs" was used
+				// and matching from "lc_col" might give
+				// another match.
+				spp->sp_m_reuse = r && re_extmatch_out == NULL
+				       && !re_has_zstart(regmatch.regprog);
+				spp->sp_m_col = lc_col;
+				spp->sp_m_startpos = regmatch.startpos[0];
+				spp->sp_m_endpos = regmatch.endpos[0];
+			    }
+			    spp->sp_line_id = current_line_id;
 			    if (!r)
 			    {
 				// no match in this line, try another one
@@ -3137,6 +3681,35 @@ syn_getcurline_len(void)
     return ml_get_buf_len(syn_buf, current_lnum);
 }
 
+/*
+ * Return FALSE when pattern "spp" cannot match in the current line, because
+ * the line has none of the bytes of which the match needs one.  The bytes in
+ * the line are found only once, so that with many patterns checking them is
+ * much cheaper than matching each one.
+ */
+    static int
+syn_line_may_match(synpat_T *spp)
+{
+    char_u	*p;
+    int		i;
+
+    if (!spp->sp_need_ok)
+	return TRUE;
+    if (current_bytes_line_id != current_line_id
+					  || current_bytes_lnum != current_lnum)
+    {
+	CLEAR_FIELD(current_bytes);
+	for (p = syn_getcurline(); *p != NUL; ++p)
+	    current_bytes[*p >> 3] |= 1 << (*p & 7);
+	current_bytes_line_id = current_line_id;
+	current_bytes_lnum = current_lnum;
+    }
+    for (i = 0; i < (int)sizeof(current_bytes); ++i)
+	if (spp->sp_need[i] & current_bytes[i])
+	    return TRUE;
+    return FALSE;
+}
+
 /*
  * Call vim_regexec() to find a match with "rmp" in "syn_buf".
  * Returns TRUE when there is a match.
@@ -3214,31 +3787,41 @@ check_keyword_id(
     char_u	*kwp;
     int		round;
     int		kwlen;
+    int		i;
+    int		ascii = TRUE;
     char_u	keyword[MAXKEYWLEN + 1]; // assume max. keyword len is 80
     hashtab_T	*ht;
     hashitem_T	*hi;
 
     // Find first character after the keyword.  First character was already
-    // checked.
+    // checked.  This is done for every word, avoid the multi-byte functions
+    // for ASCII.
     kwp = line + startcol;
     kwlen = 0;
     do
     {
-	if (has_mbyte)
-	    kwlen += (*mb_ptr2len)(kwp + kwlen);
-	else
+	if (kwp[kwlen] < 0x80)
 	    ++kwlen;
+	else
+	{
+	    ascii = FALSE;
+	    if (has_mbyte)
+		kwlen += (*mb_ptr2len)(kwp + kwlen);
+	    else
+		++kwlen;
+	}
+	if (kwlen > MAXKEYWLEN)
+	    return 0;
     }
-    while (vim_iswordp_buf(kwp + kwlen, syn_buf));
-
-    if (kwlen > MAXKEYWLEN)
-	return 0;
+    while (kwp[kwlen] < 0x80 ? vim_iswordc_buf(kwp[kwlen], syn_buf)
+				       : vim_iswordp_buf(kwp + kwlen, syn_buf));
 
     /*
      * Must make a copy of the keyword, so we can add a NUL and make it
      * lowercase.
      */
-    vim_strncpy(keyword, kwp, kwlen);
+    mch_memmove(keyword, kwp, (size_t)kwlen);
+    keyword[kwlen] = NUL;
 
     /*
      * Try twice:
@@ -3251,7 +3834,14 @@ check_keyword_id(
 	if (ht->ht_used == 0)
 	    continue;
 	if (round == 2)	// ignore case
-	    (void)str_foldcase(kwp, kwlen, keyword, MAXKEYWLEN + 1);
+	{
+	    // Same as str_foldcase(), but quicker for ASCII.
+	    if (ascii && enc_utf8 && (cmp_flags & CMP_KEEPASCII))
+		for (i = 0; i < kwlen; ++i)
+		    keyword[i] = TOLOWER_ASC(kwp[i]);
+	    else
+		(void)str_foldcase(kwp, kwlen, keyword, MAXKEYWLEN + 1);
+	}
 
 	/*
 	 * Find keywords that match.  There can be several with different
@@ -5657,6 +6247,7 @@ get_syn_pattern(char_u *arg, synpat_T *ci)
     if (ci->sp_prog == NULL)
 	return NULL;
     ci->sp_ic = curwin->w_s->b_syn_ic;
+    ci->sp_need_ok = vim_regneed(ci->sp_prog, ci->sp_ic, ci->sp_need) == OK;
 #ifdef FEAT_PROFILE
     syn_clear_time(&ci->sp_time);
 #endif
@@ -629,6 +629,7 @@ term_start(
     vim_free(curbuf->b_sfname);
     curbuf->b_sfname = vim_strsave(curbuf->b_ffname);
     curbuf->b_fname = curbuf->b_ffname;
+    buf_index_invalidate();
 
     apply_autocmds(EVENT_BUFFILEPOST, NULL, NULL, FALSE, curbuf);
 
@@ -18,6 +18,91 @@ endfunc
 
 func Test_Regex_Benchmark()
   call Measure('samples/re.freeze.txt', '\s\+\%#\@<!$', '+5')
+  " patterns without a first character to look for, which don't match
+  call Measure('samples/re.freeze.txt', '\d\+\.\d\+em', '')
+  call Measure('../regexp_bt.c', '\<\h\w*\s*(\s*xyz', '')
+endfunc
+
+" Patterns as used in syntax files and for searching, matched against a
+" generated buffer with both engines.  When "benchmark.ref" exists, e.g. a
+" copy of "benchmark.out" made with another build, the time relative to what
+" it contains is added.
+let s:corpus = [
+      \ '\<\h\w*\ze\s*(',
+      \ '"\%(\\.\|[^"\\]\)*"',
+      \ '/\*.\{-}\*/',
+      \ '\<\%(if\|else\|while\|for\|return\)\>',
+      \ '^\s*#\s*\%(define\|include\|ifdef\)\>',
+      \ '\<0x\x\+\>\|\<\d\+\%(\.\d*\)\=\>',
+      \ '</\=\h\w*\%(\s\+\h\w*=\%("[^"]*"\|\S\+\)\)*\s*>',
+      \ '\s\+$',
+      \ '\<TODO\>\|\<FIXME\>\|\<XXX\>',
+      \ '\cerror',
+      \ '\<[A-Z_]\{3,}\>',
+      \ '\w\+\s*=\s*\w\+;',
+      \ '\%(foo\|bar\)baz',
+      \ '\k\+ \k\+ \k\+$',
+      \ ]
+
+func s:CorpusLines()
+  let words = ['int', 'char', 'if', 'else', 'while', 'return', 'foo', 'bar',
+        \ 'count', 'MAX_LEN', 'NULL', '0x1f', '3.14', '42', '=', ';', '(',
+        \ ')', '{', '}', '"text \"quoted\""', '/* comment */',
+        \ '<div class="x">', '</div>', 'TODO', 'Error', 'ptr->next',
+        \ '#define', '//', 'naïve']
+  let seed = srand(42)
+  let lines = []
+  for i in range(20000)
+    let line = repeat(' ', rand(seed) % 9)
+    for j in range(rand(seed) % 12)
+      let line ..= words[rand(seed) % len(words)] .. ' '
+    endfor
+    call add(lines, line)
+  endfor
+  return lines
+endfunc
+
+func Test_Regex_Benchmark_Corpus()
+  new
+  call setline(1, s:CorpusLines())
+  let bytes = line2byte(line('$') + 1) - 1
+
+  let ref = {}
+  if filereadable('benchmark.ref')
+    for line in readfile('benchmark.ref')
+      let m = matchlist(line, '^corpus re: \(\d\), \([0-9.]\+\) ns/byte, \d\+ matches: \(.*\)$')
+      if !empty(m)
+        let ref[m[1] .. m[3]] = str2float(m[2])
+      endif
+    endfor
+  endif
+
+  let out = []
+  let counts = {}
+  for re in [1, 2]
+    let &regexpengine = re
+    for pat in s:corpus
+      let start = reltime()
+      let n = execute('%s/' .. escape(pat, '/') .. '//gne')
+      let nsbyte = reltimefloat(reltime(start)) * 1000000000.0 / bytes
+      let n = str2nr(trim(n))
+      " both engines must find the same matches
+      if re == 1
+        let counts[pat] = n
+      else
+        call assert_equal(counts[pat], n, pat)
+      endif
+      let s = printf('corpus re: %d, %.2f ns/byte, %d matches: %s',
+            \ re, nsbyte, n, pat)
+      if get(ref, re .. pat, 0.0) > 0.0
+        let s ..= printf(' (%.2f times the reference)', nsbyte / ref[re .. pat])
+      endif
+      call add(out, s)
+    endfor
+  endfor
+  set regexpengine&
+  call writefile(out, 'benchmark.out', 'a')
+  bwipe!
 endfunc
 
 " vim: shiftwidth=2 sts=2 expandtab
@@ -640,4 +640,39 @@ func Test_switch_to_previously_viewed_buffer()
   set startofline&
 endfunc
 
+" Finding a buffer by name must keep working when many buffers exist and when
+" a buffer is renamed.
+func Test_lookup_many_buffers()
+  let first = bufnr('$') + 1
+  for i in range(1, 1000)
+    exe 'badd Xmanybuf' .. i
+  endfor
+  call assert_equal(first + 999, bufnr('$'))
+  for i in range(1, 1000, 37)
+    call assert_equal(first + i - 1, bufnr('Xmanybuf' .. i .. '$'))
+  endfor
+  badd Xmanybuf500
+  call assert_equal(first + 999, bufnr('$'))
+
+  " After renaming the old name is used by a new buffer.
+  exe 'buffer ' .. (first + 499)
+  file Xmanybuf_renamed
+  let last = bufnr('$')
+  call assert_equal(first + 1000, last)
+  badd Xmanybuf_renamed
+  badd Xmanybuf500
+  call assert_equal(last, bufnr('$'))
+  call assert_equal(first + 499, bufnr('^Xmanybuf_renamed$'))
+  call assert_equal(last, bufnr('^Xmanybuf500$'))
+
+  " A file that exists is also found by its inode.
+  call writefile(['x'], 'Xmanybuf_file', 'D')
+  badd Xmanybuf_file
+  let nr = bufnr('$')
+  exe 'badd ' .. getcwd() .. '/Xmanybuf_file'
+  call assert_equal(nr, bufnr('$'))
+
+  %bwipe!
+endfunc
+
 " vim: shiftwidth=2 sts=2 expandtab
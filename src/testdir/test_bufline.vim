@@ -156,6 +156,27 @@ func Test_appendbufline()
   exe "bwipe! " . b
 endfunc
 
+func Test_append_many_lines()
+  new
+  call setline(1, ['first', 'last'])
+  let lines = range(1, 20000)->map({_, v -> 'line ' .. v})
+  call assert_equal(0, append(1, lines))
+  call assert_equal(20002, line('$'))
+  call assert_equal(['first', 'line 1', 'line 2'], getline(1, 3))
+  call assert_equal(['line 20000', 'last'], getline(20001, 20002))
+  call assert_equal(lines, getline(2, 20001))
+  call assert_equal(strlen(join(getline(1, '$'), "\n")),
+        \ line2byte('$') + strlen(getline('$')) - 1)
+
+  " Items that are not a String are converted.
+  call assert_equal(0, append(0, [1, 'two', 3.5]))
+  call assert_equal(['1', 'two', '3.5', 'first'], getline(1, 4))
+  call assert_equal(0, setline(20004, ['x', 'y'] + lines))
+  call assert_equal(20003 + 20002, line('$'))
+  call assert_equal(['x', 'y', 'line 1'], getline(20004, 20006))
+  bwipe!
+endfunc
+
 func Test_appendbufline_no_E315()
   let after =<< trim [CODE]
     set stl=%f ls=2
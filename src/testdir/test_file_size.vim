@@ -56,4 +56,78 @@ func Test_File_Read_Write()
   call delete("Xtest")
 endfunc
 
+" Test reading files of over 1 Mbyte in various formats.
+func Test_File_Read_Large()
+  let lines = map(range(1, 100000), '"line " .. v:val')
+
+  " Unix format, a NUL byte and no end-of-line at the end.
+  let lines[500] = "with\nnul"
+  call writefile(lines, 'Xlarge', 'bD')
+  edit! Xlarge
+  call assert_equal('unix', &fileformat)
+  call assert_equal(100000, line('$'))
+  call assert_equal('line 1', getline(1))
+  call assert_equal("with\nnul", getline(501))
+  call assert_equal('line 100000', getline('$'))
+  call assert_false(&endofline)
+  call assert_equal(lines, getline(1, '$'))
+  bwipe!
+
+  " Dos format
+  call writefile(map(copy(lines), 'v:val .. "\r"'), 'Xlarge', 'D')
+  edit! Xlarge
+  call assert_equal('dos', &fileformat)
+  call assert_equal(lines, getline(1, '$'))
+  bwipe!
+
+  " Mac format
+  call writefile([join(lines, "\r") .. "\r"], 'Xlarge', 'bD')
+  set fileformats=unix,mac
+  edit! Xlarge
+  call assert_equal('mac', &fileformat)
+  call assert_equal(lines, getline(1, '$'))
+  bwipe!
+  set fileformats&
+
+  " UTF-8 with a BOM
+  let lines[0] = "\xef\xbb\xbfline 1"
+  call writefile(lines, 'Xlarge', 'D')
+  edit! Xlarge
+  call assert_true(&bomb)
+  call assert_equal('line 1', getline(1))
+  call assert_equal('line 100000', getline('$'))
+  bwipe!
+
+  " Illegal UTF-8 byte, read as latin1
+  let lines[0] = "line \xe9"
+  call writefile(lines, 'Xlarge', 'D')
+  set fileencodings=utf-8,latin1
+  edit! Xlarge
+  call assert_equal('latin1', &fileencoding)
+  call assert_equal('line é', getline(1))
+  call assert_equal('line 100000', getline('$'))
+  bwipe!
+  set fileencodings&
+
+  " A line longer than the part that is read at a time
+  let lines[1000] = repeat('x', 3000000)
+  call writefile(lines, 'Xlarge', 'D')
+  edit! Xlarge
+  call assert_equal(100000, line('$'))
+  call assert_equal(3000000, strlen(getline(1001)))
+  call assert_equal('line 1002', getline(1002))
+  bwipe!
+
+  " Read in the middle of an existing buffer
+  call writefile(lines, 'Xlarge', 'D')
+  new
+  call setline(1, ['first', 'last'])
+  1read Xlarge
+  call assert_equal(100002, line('$'))
+  call assert_equal('first', getline(1))
+  call assert_equal('line é', getline(2))
+  call assert_equal('last', getline('$'))
+  bwipe!
+endfunc
+
 " vim: shiftwidth=2 sts=2 expandtab
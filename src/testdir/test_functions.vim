@@ -1456,6 +1456,34 @@ func Test_byte2line_line2byte()
   bw!
 endfunc
 
+" Test byte2line() and line2byte() with many lines, after inserting and
+" deleting lines all over the buffer.
+func Test_byte2line_line2byte_many_lines()
+  new
+  call setline(1, range(1, 6000)->map({_, v -> repeat('x', v % 7)}))
+  for lnum in range(5900, 10, -53)
+    call append(lnum, ['', 'abc', 'defgh'])
+    exe lnum - 5 .. ',' .. lnum - 4 .. 'delete'
+  endfor
+  for ff in ['unix', 'dos']
+    let &fileformat = ff
+    let nl = ff == 'dos' ? 2 : 1
+    let offset = 1
+    for lnum in range(1, line('$'))
+      if lnum % 37 == 0 || lnum > line('$') - 3
+        call assert_equal(offset, line2byte(lnum))
+        call assert_equal(lnum, byte2line(offset))
+        call assert_equal(lnum, byte2line(offset + len(getline(lnum))))
+      endif
+      let offset += len(getline(lnum)) + nl
+    endfor
+    call assert_equal(offset, line2byte(line('$') + 1))
+  endfor
+
+  set fileformat&
+  bw!
+endfunc
+
 " Test for byteidx() using a character index
 func Test_byteidx()
   let a = '.é.' " one char of two bytes
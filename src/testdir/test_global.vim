@@ -126,6 +126,42 @@ func Test_global_wrong_delimiter()
   call assert_fails('g x^bxd', 'E146:')
 endfunc
 
+" Test :global, :vglobal, :substitute and search() on a buffer with many lines
+" that cannot match, which are skipped without trying to match each line.
+func Test_global_skip_lines()
+  new
+  call setline(1, range(1, 5000)->map({_, v -> v % 1000 == 7 ? 'a needle' : 'line ' .. v}))
+  for re in range(3)
+    let &regexpengine = re
+    for pat in ['needle', '\<needle\>', 'x\|needle', '\cNEEDLE', 'a n', 'ne*dle$']
+      let g:lnums = []
+      exe 'g/' .. pat .. '/call add(g:lnums, line("."))'
+      call assert_equal([7, 1007, 2007, 3007, 4007], g:lnums, pat)
+      let g:count = 0
+      exe 'v/' .. pat .. '/let g:count += 1'
+      call assert_equal(4995, g:count, pat)
+
+      call cursor(1, 1)
+      call assert_equal(7, search(pat, 'W'), pat)
+      call assert_equal(1007, search(pat, 'W'), pat)
+      call assert_equal(0, search(pat, 'W', 1500), pat)
+      call cursor(4500, 1)
+      call assert_equal(7, search(pat, 'w'), pat)
+      call assert_equal(4007, search(pat, 'bw'), pat)
+
+      exe '2000,$s/' .. pat .. '/X/'
+      call assert_equal([0, 1, 1, 1],
+	    \ [1007, 2007, 3007, 4007]->map({_, v -> getline(v) =~ 'X'}), pat)
+      call setline(2007, 'a needle')
+      call setline(3007, 'a needle')
+      call setline(4007, 'a needle')
+    endfor
+  endfor
+  set regexpengine&
+  bwipe!
+  unlet g:lnums g:count
+endfunc
+
 " Test for interrupting :global using Ctrl-C
 func Test_interrupt_global()
   CheckRunVimInTerminal
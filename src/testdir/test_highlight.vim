@@ -1089,6 +1089,52 @@ func Test_colornames_assignment_and_unassignment()
 endfunc
 
 " Test for the hlget() function
+" Highlight groups combined with 'cursorline' and matches.  The same
+" combination must always get the same attribute.
+func Test_highlight_combined_attrs()
+  let save_t_Co = &t_Co
+  set t_Co=256
+  new
+  only
+  call setline(1, range(1, 20)->map({_, v -> 'line ' .. v}))
+  for i in range(1, 5)
+    exe 'hi HlComb' .. i .. ' ctermfg=' .. (i + 1) .. ' ctermbg=' .. (i * 7)
+  endfor
+  " line N uses the same group as line N + 5
+  for lnum in range(1, 20)
+    call matchaddpos('HlComb' .. ((lnum - 1) % 5 + 1), [[lnum, 1, 4]])
+  endfor
+  hi HlCombLine ctermbg=52 cterm=underline
+  hi! link CursorLine HlCombLine
+  setlocal cursorline cursorlineopt=line
+
+  let cursorline_attrs = {}
+  for lnum in [1, 6, 2, 1, 6, 7]
+    call cursor(lnum, 1)
+    redraw
+    let attr = screenattr(lnum, 1)
+    call assert_notequal(screenattr(lnum + 5, 1), attr)
+    let group = (lnum - 1) % 5
+    if has_key(cursorline_attrs, group)
+      call assert_equal(cursorline_attrs[group], attr)
+    endif
+    let cursorline_attrs[group] = attr
+  endfor
+  " lines with the same group and without CursorLine are equal
+  call cursor(12, 1)
+  redraw
+  call assert_equal(screenattr(3, 1), screenattr(8, 1))
+  call assert_notequal(screenattr(3, 1), screenattr(4, 1))
+
+  bwipe!
+  hi clear CursorLine
+  hi clear HlCombLine
+  for i in range(1, 5)
+    exe 'hi clear HlComb' .. i
+  endfor
+  let &t_Co = save_t_Co
+endfunc
+
 func Test_hlget()
   let lines =<< trim END
     call assert_notequal([], filter(hlget(), 'v:val.name == "Visual"'))
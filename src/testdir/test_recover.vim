@@ -76,6 +76,153 @@ func Test_swap_file()
   enew! | only
 endfunc
 
+" While typing the swap file is written in the background every
+" 'updatecount' characters.  Check that all text is restored, also when
+" flushing with sync().
+func Test_swap_file_typed()
+  set fileformat=unix undolevels=-1 updatecount=7
+  for sws in ['fsync', 'sync']
+    let &swapsync = sws
+    edit! Xtest
+    call feedkeys('i' .. repeat("abcdefghijklmnopqrstuvwxyz\<CR>", 300)
+          \ .. "\<Esc>", 'xt')
+    call feedkeys('gg' .. repeat('Ax0123456789' .. "\<Esc>j", 300), 'xt')
+    call assert_equal(301, line('$'))
+
+    let swname = CopySwapfile()
+
+    new
+    only!
+    bwipe! Xtest
+    call rename('Xswap', swname)
+    recover Xtest
+    call delete(swname)
+    call assert_equal(301, line('$'), sws)
+    call assert_equal(repeat(['abcdefghijklmnopqrstuvwxyzx0123456789'], 300),
+          \ getline(1, 300), sws)
+    bwipe!
+  endfor
+
+  set undolevels& updatecount& swapsync&
+  enew! | only
+endfunc
+
+" With 'swapjournal' the changes after the last checkpoint are not written to
+" the swap file but to the journal.  Check that recovery applies them.
+func Test_swap_file_journal()
+  CheckUnix
+  set fileformat=unix undolevels=-1 updatecount=7 swapjournal
+  edit! Xjournal
+  call feedkeys('i' .. repeat("abcdefghijklmnopqrstuvwxyz\<CR>", 100)
+        \ .. "\<Esc>", 'xt')
+  let swname = swapname('')
+  call assert_true(filereadable(swname .. 'j'))
+  let swap = readblob(swname)
+
+  call feedkeys('gg' .. repeat('Ax0123456789' .. "\<Esc>j", 50), 'xt')
+  call feedkeys('ggddGdk' .. repeat('k', 10), 'xt')
+  call assert_equal(98, line('$'))
+  " the swap file was not written
+  call assert_equal(swap, readblob(swname))
+  let journal = readblob(swname .. 'j')
+  let text = getline(1, '$')
+
+  new
+  only!
+  bwipe! Xjournal
+  call assert_false(filereadable(swname .. 'j'))
+  call writefile(swap, swname)
+  call writefile(journal, swname .. 'j')
+  let msg = execute('recover Xjournal')
+  call assert_match('Applied \d\+ changes from journal', msg)
+  call delete(swname)
+  call delete(swname .. 'j')
+  call assert_equal(text, getline(1, '$'))
+
+  set undolevels& updatecount& swapjournal&
+  enew! | only
+endfunc
+
+" With 'swapjournal' the changed blocks are kept in memory until a checkpoint.
+" When they use more than 'maxmem' a checkpoint is done.  Renaming the swap
+" file also writes all changes to it, the journal is deleted then.
+func Test_swap_file_journal_checkpoint()
+  CheckUnix
+  set fileformat=unix undolevels=-1 updatecount=7 swapjournal maxmem=1
+  edit! Xjournal
+  call feedkeys("iabcdefgh\<Esc>", 'xt')
+  let swname = swapname('')
+  call assert_true(filereadable(swname .. 'j'))
+  let size = getfsize(swname)
+
+  call append(1, repeat(['abcdefghijklmnopqrstuvwxyz0123456789'], 5000))
+  " the changed blocks were written by a checkpoint
+  call assert_true(getfsize(swname) > size + 100000)
+  " typing syncs the changes after the checkpoint to the journal
+  call feedkeys("GA0123456789\<Esc>", 'xt')
+  let text = getline(1, '$')
+  let swap = readblob(swname)
+  let journal = readblob(swname .. 'j')
+  new
+  only!
+  bwipe! Xjournal
+  call writefile(swap, swname)
+  call writefile(journal, swname .. 'j')
+  recover Xjournal
+  call delete(swname)
+  call delete(swname .. 'j')
+  call assert_equal(text, getline(1, '$'))
+
+  call feedkeys("ggA0123456789\<Esc>", 'xt')
+  let swname = swapname('')
+  call assert_true(filereadable(swname .. 'j'))
+  call setline(100, 'changed')
+  file Xjournal2
+  let swname = swapname('')
+  call assert_false(filereadable(swname .. 'j'))
+  let text = getline(1, '$')
+  let swap = readblob(swname)
+  new
+  only!
+  bwipe! Xjournal2
+  call writefile(swap, swname)
+  recover Xjournal2
+  call delete(swname)
+  call assert_equal(text, getline(1, '$'))
+
+  set undolevels& updatecount& swapjournal& maxmem&
+  enew! | only
+endfunc
+
+" A large file is stored in larger blocks.  With a small 'maxmem' most blocks
+" are read back from the swap file while changing lines all over.  Check that
+" all text is restored.
+func Test_swap_file_large()
+  set fileformat=unix undolevels=-1 maxmem=1000
+  let text = repeat('x', 100)
+  call writefile(range(1, 180000)->map({_, v -> v .. text}), 'Xlarge', 'D')
+  edit! Xlarge
+  g/^\d*5x/s/x/y/
+  let swname = CopySwapfile()
+  " page size is 8192
+  call assert_equal(0z00200000, readblob(swname, 12, 4))
+
+  new
+  only!
+  bwipe! Xlarge
+  call rename('Xswap', swname)
+  recover Xlarge
+  call delete(swname)
+  call assert_equal(180000, line('$'))
+  call assert_equal('4' .. text, getline(4))
+  call assert_equal('5y' .. text[1:], getline(5))
+  call assert_equal('179995y' .. text[1:], getline(179995))
+  call assert_equal('180000' .. text, getline(180000))
+
+  set undolevels& maxmem&
+  enew! | only
+endfunc
+
 func Test_nocatch_process_still_running()
   " sysinfo.uptime probably only works on Linux
   if !has('linux')
@@ -80,6 +80,23 @@ func Test_backref()
   bwipe!
 endfunc
 
+" Backref that spans lines in different blocks.
+func Test_backref_multiline()
+  new
+  let long = repeat('x', 3000)
+  call setline(1, [long .. 'a', 'b' .. long, long .. 'a', 'b' .. long, 'end'])
+  for re in [1, 2]
+    let pat = '\%#=' .. re .. 'x\(a\nb\)x*\n\(x*\)\1'
+    call cursor(5, 1)
+    call assert_equal([1, 3000], searchpos(pat), 're=' .. re)
+    call setline(4, 'c' .. long)
+    call cursor(5, 1)
+    call assert_equal([0, 0], searchpos(pat), 're=' .. re)
+    call setline(4, 'b' .. long)
+  endfor
+  bwipe!
+endfunc
+
 func Test_multi_failure()
   set re=1
   call assert_fails('/a**', 'E61:')
@@ -127,7 +144,7 @@ func Test_out_of_memory()
   new
   s/^/,n
   " This will be slow...
-  call assert_fails('call search("\\v((n||<)+);")', 'E363:')
+  call assert_fails('call search("\\%#=1\\v((n||<)+);")', 'E363:')
 endfunc
 
 func Test_get_equi_class()
@@ -1133,6 +1150,128 @@ func Test_using_two_engines_pattern()
   bwipe!
 endfunc
 
+" Compiled patterns are cached, using the same pattern again must give the
+" same result.
+func Test_regexp_cache()
+  let stats = regcachestats()
+  call assert_equal(['count', 'hits', 'misses', 'size', 'switched'],
+	\ keys(stats)->sort())
+  for i in range(10)
+    call assert_true('some text' =~ 'so\(me\) t')
+    call assert_false('some text' =~ 'so\(me\) x')
+  endfor
+  let new = regcachestats()
+  call assert_inrange(stats.hits + 18, stats.hits + 20, new.hits)
+  call assert_inrange(new.count, new.size, new.count)
+
+  " Using the pattern recursively needs another program.
+  call assert_equal('bbb', substitute('aaa', 'a',
+	\ '\=substitute(submatch(0), "a", "b", "")', 'g'))
+
+  " The compiled pattern depends on 'magic', 'cpoptions' and the engine.
+  new
+  call setline(1, ['axb', 'a.b', 'xt'])
+  call assert_equal(1, search('a.b', 'cnw'))
+  set nomagic
+  call assert_equal(2, search('a.b', 'cnw'))
+  set magic
+  call assert_equal(1, search('a.b', 'cnw'))
+  call assert_equal(0, search('[\t]', 'cnw'))
+  set cpo+=l
+  call assert_equal(3, search('[\t]', 'cnw'))
+  set cpo-=l
+  call assert_equal(0, search('[\t]', 'cnw'))
+  for re in range(3)
+    let &re = re
+    call assert_equal(2, match('xxfoo', 'fo\+'))
+  endfor
+  set re=0
+
+  " "~" uses the previous substitute string, not cached.
+  call setline(1, 'abc')
+  s/b/x/
+  let stats = regcachestats()
+  call assert_equal(1, match('axc', '~'))
+  call assert_equal(stats.misses, regcachestats().misses)
+  s/x/y/
+  call assert_equal(1, match('ayc', '~'))
+
+  " "\%.l" and "\%.c" use the cursor position, not cached.
+  call setline(1, ['a', 'a', 'a'])
+  call cursor(1, 1)
+  call assert_equal(1, search('\%.la', 'nc'))
+  call cursor(3, 1)
+  call assert_equal(3, search('\%.la', 'nc'))
+  call assert_equal(2, search('\%<.la', 'ncb'))
+  call cursor(2, 1)
+  call assert_equal(1, search('\%<.la', 'ncb'))
+  let stats = regcachestats()
+  call assert_equal(2, search('\%.la', 'nc'))
+  call assert_equal(stats.misses, regcachestats().misses)
+
+  " When the NFA engine is too slow the pattern keeps using the backtracking
+  " engine.
+  set re=0
+  let stats = regcachestats()
+  call test_override('nfa_fail', 1)
+  call assert_equal(1, match('xabbc', 'a\w\+c'))
+  call assert_equal(stats.switched + 1, regcachestats().switched)
+  call assert_equal(1, match('xabbc', 'a\w\+c'))
+  call assert_equal(stats.switched + 1, regcachestats().switched)
+  call test_override('nfa_fail', 0)
+
+  " Back references use the backtracking engine.
+  let msg = execute('verbose call match("xyxy", ''\(xy\)\1'')')
+  call assert_match('Switching to backtracking RE engine for pattern: \\(xy\\)\\1', msg)
+
+  " "[:keyword:]" uses 'iskeyword', not cached.
+  setlocal iskeyword=@
+  call assert_equal(-1, match('_', '\%#=1[[:keyword:]]'))
+  setlocal iskeyword=@,_
+  call assert_equal(0, match('_', '\%#=1[[:keyword:]]'))
+  setlocal iskeyword&
+  bwipe!
+endfunc
+
+" Lines that do not contain one of the literal strings of the pattern are
+" skipped, matching must still work as before.
+func Test_regexp_must_appear()
+  new
+  call setline(1, ['foo', 'xbarx', 'Baz', 'nothing', 'fo o', 'xFOOy bar',
+        \ 'abcd', 'ab12'])
+  for i in range(0, 2)
+    exe "set re=" .. i
+    set noignorecase
+    let found = []
+    g/foo\|bar/call add(found, line('.'))
+    call assert_equal([1, 2, 6], found)
+    let found = []
+    g/\w*foo\w*/call add(found, line('.'))
+    call assert_equal([1], found)
+    let found = []
+    g/[xy]ba[rz]\|\(ab\|cd\)\(cd\|12\)/call add(found, line('.'))
+    call assert_equal([2, 7, 8], found)
+    let found = []
+    g/\cfoo\|baz/call add(found, line('.'))
+    call assert_equal([1, 3, 6], found)
+    let found = []
+    g/o\@<=\s*o\|nothing$/call add(found, line('.'))
+    call assert_equal([1, 4, 5], found)
+
+    set ignorecase
+    let found = []
+    g/foo\|baz/call add(found, line('.'))
+    call assert_equal([1, 3, 6], found)
+    let found = []
+    g/\Cfoo\|BAZ\|o\%[ab]cd/call add(found, line('.'))
+    call assert_equal([1], found)
+    call assert_equal(1, 'xFOOy' =~ '\<\(x\|y\)foo')
+    call assert_equal(0, 'xFOOy' =~ '\<\(x\|y\)food')
+  endfor
+  set re=0 ignorecase&
+  bwipe!
+endfunc
+
 func Test_recursive_substitute_expr()
   new
   func Repl()
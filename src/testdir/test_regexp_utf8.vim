@@ -618,6 +618,22 @@ func Test_search_multibyte_match_ascii()
   bw!
 endfunc
 
+" ASCII text is compared without decoding, a non-ASCII character may still
+" fold to an ASCII one.
+func Test_ignorecase_ascii_and_multibyte()
+  for re in range(3)
+    let pre = '\%#=' .. re .. '\c'
+    call assert_equal(2, match('xyFoO', pre .. 'foo'), 're=' .. re)
+    call assert_equal(5, match('ÄBC abc', pre .. 'abc'), 're=' .. re)
+    call assert_equal(4, match("abc \u212a", pre .. 'k'), 're=' .. re)
+    call assert_equal(4, match("xyz \u17f", pre .. 's'), 're=' .. re)
+    call assert_equal(-1, match('abd abe', pre .. 'abc'), 're=' .. re)
+    call assert_equal(['ABC', 'abc'],
+          \ matchstrlist(['x ABC', 'y abc', 'abd'], pre .. 'abc')
+          \ ->map({_, v -> v.text}), 're=' .. re)
+  endfor
+endfunc
+
 func Test_replace_multibyte_match_in_multi_lines()
   new
   let text = ['ab 1c', 'ab 1c', 'def', '是否 a', '是否 a', 'ghi', '是否a', '是否a', '是否 1', '是否 1']
@@ -633,4 +649,37 @@ func Test_replace_multibyte_match_in_multi_lines()
   set ignorecase&vim re&vim
 endfun
 
+" The NFA engine first checks with a DFA whether a line can match, the result
+" must be the same as with the backtracking engine.
+func Test_regexp_dfa_prefilter()
+  let words = ['foo', 'bar', 'x_', 'Foo', 'BAR', ' ', "\t", '.', '-', '12', 'é', 'ü']
+  let lines = ['']
+  for w1 in words
+    for w2 in words
+      call add(lines, w1 .. w2 .. 'foo' .. w2 .. w1)
+      call add(lines, w2 .. w1)
+    endfor
+  endfor
+  let pats = ['\<foo\w\+', 'foo\>', '^foo', 'bar$', '\cfoo', 'o\{2}b', '[a-c]\d',
+        \ '[^a-z ]\+', '\s\+$', '\k\+\>', '^\s*\S', 'x\|y\|z', '\(fo\)\+b',
+        \ '\v<(foo|bar)>', 'o\zsb', '\<\u', '\H\d', '\.-', 'f\%[oob]ar', 'é', '\<ü']
+  for ic in [0, 1]
+    let &ignorecase = ic
+    " \< and \k depend on 'iskeyword'
+    for isk in ['@,48-57,_,192-255', '@,-']
+      let &iskeyword = isk
+      for pat in pats
+        for line in lines
+          let msg = pat .. ' in "' .. line .. '" ic: ' .. ic .. ' isk: ' .. isk
+          call assert_equal(match(line, '\%#=1' .. pat),
+                \ match(line, '\%#=2' .. pat), msg)
+          call assert_equal(match(line, '\%#=1' .. pat, 3),
+                \ match(line, '\%#=2' .. pat, 3), msg)
+        endfor
+      endfor
+    endfor
+  endfor
+  set ignorecase& iskeyword&
+endfunc
+
 " vim: shiftwidth=2 sts=2 expandtab
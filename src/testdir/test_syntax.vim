@@ -86,6 +86,71 @@ func Test_syn_iskeyword()
   quit!
 endfunc
 
+func Test_syntax_keyword_case()
+  new
+  let long = repeat('x', 80)
+  call setline(1, ['foo FOO Foo fooé foo_ bar BAR Über über ' .. long,
+        \ long .. 'x'])
+  syn keyword Match foo
+  syn case ignore
+  syn keyword Ignore bar über
+  exe 'syn keyword Ignore ' .. long
+  let expected = [[1, 'Match'], [5, ''], [9, ''], [13, ''], [19, ''],
+        \ [24, 'Ignore'], [28, 'Ignore'], [32, 'Ignore'], [38, 'Ignore'],
+        \ [44, 'Ignore']]
+  for [col, name] in expected
+    call assert_equal(name, synIDattr(synID(1, col, 1), 'name'), 'col ' .. col)
+  endfor
+  call assert_equal('', synIDattr(synID(2, 1, 1), 'name'))
+
+  " ASCII is folded with the locale when 'casemap' does not have "keepascii"
+  set casemap=internal
+  call assert_equal('Ignore', synIDattr(synID(1, 24, 1), 'name'))
+  call assert_equal('Ignore', synIDattr(synID(1, 28, 1), 'name'))
+  set casemap&
+
+  syn clear
+  bwipe!
+endfunc
+
+func Test_syntax_match_many_in_line()
+  new
+  call setline(1, ["aa bb aa xyz xxyz #x K", 'none here'])
+  syn match A /aa/
+  syn match B /bb/
+  syn match Z /x\zsyz/
+  syn match H /#\w/
+  syn match N /qq/
+  syn case ignore
+  syn match K /k/
+  let expected = [[1, 'A'], [3, ''], [4, 'B'], [7, 'A'], [10, ''], [11, 'Z'],
+        \ [14, ''], [15, ''], [16, 'Z'], [19, 'H'], [20, 'H'], [22, 'K']]
+  for [col, name] in expected
+    call assert_equal(name, synIDattr(synID(1, col, 1), 'name'), 'col ' .. col)
+  endfor
+  call assert_equal('', synIDattr(synID(2, 1, 1), 'name'))
+
+  syn clear
+  bwipe!
+endfunc
+
+" A match that is used again must not get the external submatches of a region
+" start that matched after it.
+func Test_syntax_match_reuse_extmatch()
+  new
+  call setline(1, 'azzb plain first zz text end zzend')
+  syntax region testPlain start=/plain/ end=/\z1end/
+  syntax region testZ start=/\z(zz\)/ end=/\z1/
+  syntax match testFirst /first/
+  syntax match testAzzb /azzb/
+  call assert_equal('testPlain', synIDattr(synID(1, 26, 0), 'name'))
+  call assert_equal('', synIDattr(synID(1, 29, 0), 'name'))
+  call assert_equal('testZ', synIDattr(synID(1, 32, 0), 'name'))
+
+  syn clear
+  bwipe!
+endfunc
+
 func Test_syntax_after_reload()
   split Xsomefile
   call setline(1, ['hello', 'there'])
@@ -137,6 +202,145 @@ func Test_syntime()
   bd
 endfunc
 
+" With "sync fromstart" syntax is parsed ahead while waiting for a typed
+" character, jumping to the end then only needs to parse the last few lines.
+func Test_syntax_fromstart_idle_parse()
+  CheckFeature profile
+  CheckRunVimInTerminal
+
+  let lines =<< trim END
+    call setline(1, ['/* comment'] + repeat(['some text'], 3000) + ['*/', 'after'])
+    syntax match testWord /\<text\>/
+    syntax region testComment start=+/\*+ end=+\*/+ contains=testWord
+    syntax sync fromstart
+    syntime on
+    " Write the line count when parsing ahead reached the end of the buffer.
+    call timer_start(10, {-> test_getvalue('syntax_idle_lnum') == line('$')
+          \ ? writefile([line('$')], 'Xidledone') : 0}, #{repeat: -1})
+    func Check(lnum, col)
+      syntime clear
+      let name = synIDattr(synID(a:lnum, a:col, 0), 'name')
+      let report = execute('syntime report')
+      let n = matchstr(report, '\d\+\ze \+\d\+ \+[0-9.]\+ \+[0-9.]\+ \+testWord ')
+      call writefile([name, n], 'Xidleresult')
+    endfunc
+  END
+  call writefile(lines, 'XidleParse.vim', 'D')
+  let buf = RunVimInTerminal('-S XidleParse.vim', {})
+
+  " Wait for parsing while idle to be done.
+  call WaitForAssert({-> assert_equal(['3003'], filereadable('Xidledone')
+        \ ? readfile('Xidledone') : [])})
+  call term_sendkeys(buf, ":call Check(3001, 1)\r")
+  call WaitForAssert({-> assert_equal(2, filereadable('Xidleresult')
+        \ ? len(readfile('Xidleresult')) : 0)})
+  let result = readfile('Xidleresult')
+  call assert_equal('testComment', result[0])
+  call assert_inrange(1, 300, str2nr(result[1]))
+  call delete('Xidleresult')
+
+  " Removing the comment start must parse the lines again.
+  call term_sendkeys(buf, ":1delete\r")
+  call WaitForAssert({-> assert_equal(['3002'], readfile('Xidledone'))})
+  call term_sendkeys(buf, ":call Check(3000, 6)\r")
+  call WaitForAssert({-> assert_equal(2, filereadable('Xidleresult')
+        \ ? len(readfile('Xidleresult')) : 0)})
+  call assert_equal('testWord', readfile('Xidleresult')[0])
+
+  call StopVimInTerminal(buf)
+  call delete('Xidleresult')
+  call delete('Xidledone')
+endfunc
+
+" A slow pattern far below the window stops parsing ahead after 'redrawtime'.
+func Test_syntax_idle_parse_redrawtime()
+  CheckFeature reltime
+  CheckRunVimInTerminal
+
+  let lines =<< trim END
+    call setline(1, repeat(['text'], 1000) + [repeat('a', 40) .. 'b', 'end'])
+    set regexpengine=1 redrawtime=200
+    syntax match testSlow /\v(a|aa)*$/
+    syntax sync fromstart
+  END
+  call writefile(lines, 'XidleSlow.vim', 'D')
+  let buf = RunVimInTerminal('-S XidleSlow.vim', {})
+
+  call WaitForAssert({-> assert_match("'redrawtime' exceeded",
+        \ term_getline(buf, 20))})
+  call term_sendkeys(buf, ":echo 'done'\r")
+  call WaitForAssert({-> assert_match('^done ', term_getline(buf, 20))})
+
+  call StopVimInTerminal(buf)
+endfunc
+
+func s:DefineUndoSyntax(word)
+  exe 'syntax match testWord /\<' .. a:word .. '\>/'
+  syntax region testComment start=+/\*+ end=+\*/+ contains=testWord
+  syntax sync fromstart
+endfunc
+
+func s:CountWordMatches()
+  let report = execute('syntime report')
+  return str2nr(matchstr(report,
+        \ '\d\+\ze \+\d\+ \+[0-9.]\+ \+[0-9.]\+ \+testWord '))
+endfunc
+
+" The syntax states are stored in the undo file and used when editing the
+" file again with the same syntax.
+func Test_syntax_states_in_undo_file()
+  CheckFeature persistent_undo
+  CheckFeature profile
+
+  call writefile(['/* comment'] + repeat(['some text'], 3000) + ['*/', 'after'],
+        \ 'Xsynundo.txt', 'D')
+  new Xsynundo.txt
+  call s:DefineUndoSyntax('text')
+  call setline(2, 'other text')
+  write
+  normal G
+  redraw
+  wundo Xsynundo.un
+  defer delete('Xsynundo.un')
+  bwipe!
+
+  new Xsynundo.txt
+  call s:DefineUndoSyntax('text')
+  rundo Xsynundo.un
+  syntime on
+  normal G
+  redraw
+  call assert_equal('testComment', synIDattr(synID(3001, 1, 0), 'name'))
+  call assert_equal('', synIDattr(synID(3003, 1, 0), 'name'))
+  call assert_inrange(1, 300, s:CountWordMatches())
+  syntime off
+  syntime clear
+  bwipe!
+
+  " Not used when the syntax is different.
+  new Xsynundo.txt
+  call s:DefineUndoSyntax('some')
+  rundo Xsynundo.un
+  syntime on
+  normal G
+  redraw
+  call assert_equal('testWord', synIDattr(synID(3001, 1, 0), 'name'))
+  call assert_true(s:CountWordMatches() > 3000)
+  syntime off
+  syntime clear
+  bwipe!
+
+  " Not used when the text was changed before displaying it.
+  new Xsynundo.txt
+  call s:DefineUndoSyntax('text')
+  rundo Xsynundo.un
+  1delete
+  normal G
+  redraw
+  call assert_equal('', synIDattr(synID(3000, 1, 0), 'name'))
+  bwipe!
+endfunc
+
 func Test_syntime_completion()
   CheckFeature profile
 
@@ -923,6 +923,38 @@ func Test_write_binary_file()
   call delete('Xwbfile3')
 endfunc
 
+" Lines longer than the write buffer, with a NL and CR in the text.
+func Test_write_long_lines()
+  new
+  let long = repeat('abcdefghi', 20000)
+  call setline(1, ["a\nb\rc", long, long .. "\n", 'end'])
+  setlocal ff=unix
+  write! Xwlongfile
+  call assert_equal(["a\nb\rc", long, long .. "\n", 'end'],
+        \ readfile('Xwlongfile'))
+  let blob = readblob('Xwlongfile')
+  call assert_equal(6 + 180001 + 180002 + 4, len(blob))
+  call assert_equal(0z6100620D630A, blob[0 : 5])
+  call assert_equal(0z69000A656E640A, blob[-7 :])
+
+  setlocal ff=dos
+  write! Xwlongfile
+  let blob = readblob('Xwlongfile')
+  call assert_equal(7 + 180002 + 180003 + 5, len(blob))
+  call assert_equal(0z6100620D630D0A, blob[0 : 6])
+  call assert_equal(0z69000D0A656E640D0A, blob[-9 :])
+
+  setlocal ff=mac
+  write! Xwlongfile
+  let blob = readblob('Xwlongfile')
+  call assert_equal(6 + 180001 + 180002 + 4, len(blob))
+  call assert_equal(0z6100620A630D, blob[0 : 5])
+  call assert_equal(0z69000D656E640D, blob[-7 :])
+
+  call delete('Xwlongfile')
+  bwipe!
+endfunc
+
 func DoWriteDefer()
   call writefile(['some text'], 'XdeferDelete', 'D')
   call assert_equal(['some text'], readfile('XdeferDelete'))
@@ -977,6 +977,10 @@ f_test_getvalue(typval_T *argvars, typval_T *rettv)
 
     if (STRCMP(name, (char_u *)"need_fileinfo") == 0)
 	rettv->vval.v_number = need_fileinfo;
+#ifdef FEAT_SYN_HL
+    else if (STRCMP(name, (char_u *)"syntax_idle_lnum") == 0)
+	rettv->vval.v_number = curwin->w_s->b_sst_idle_lnum;
+#endif
     else
 	semsg(_(e_invalid_argument_str), name);
 }
@@ -377,6 +377,14 @@ inchar_loop(
 	    // for a character, need to check often.
 	    wait_time = 100L;
 #endif
+#ifdef FEAT_SYN_HL
+	if (wtime < 0 && (wait_time < 0 || wait_time > SYN_IDLE_MSEC)
+						     && syntax_idle_pending())
+	    // Syntax is parsed ahead in between checking for a character.
+	    // Waiting about as long as parsing one chunk takes avoids waking
+	    // up all the time.
+	    wait_time = SYN_IDLE_MSEC;
+#endif
 
 	// Wait for a character to be typed or another event, such as the winch
 	// signal or an event on the monitored file descriptors.
@@ -410,6 +418,11 @@ inchar_loop(
 	elapsed_time += wait_time;
 #endif
 
+#ifdef FEAT_SYN_HL
+	if (wtime < 0 && syntax_idle_pending())
+	    syntax_idle_parse();
+#endif
+
 	if ((resize_func != NULL && resize_func(TRUE))
 #if defined(FEAT_CLIENTSERVER) && defined(UNIX)
 		|| (
@@ -777,6 +777,11 @@ nomem:
 // extra fields for uhp
 # define UHP_SAVE_NR		1
 
+# ifdef FEAT_SYN_HL
+#  define UF_SYNTAX_MAGIC	0x5e7a	// magic before syntax states
+#  define UF_SYNTAX_MAX_LEN	(1024L * 1024L)
+# endif
+
 /*
  * Compute the hash for the current buffer text into hash[UNDO_HASH_SIZE].
  */
@@ -1530,6 +1535,64 @@ unserialize_visualinfo(bufinfo_T *bi, visualinfo_T *info)
     info->vi_curswant = undo_read_4c(bi);
 }
 
+# ifdef FEAT_SYN_HL
+/*
+ * Write the syntax states of the buffer after the undo info, so that
+ * highlighting can use them when the file is edited again.  An older Vim
+ * stops reading before them.  Not done for an encrypted undo file.
+ */
+    static int
+serialize_syntax(bufinfo_T *bi)
+{
+    char_u	*states;
+    size_t	len;
+    int		retval = OK;
+
+#  ifdef FEAT_CRYPT
+    if (bi->bi_state != NULL)
+	return OK;
+#  endif
+    states = syn_stack_get_cache(bi->bi_buf, &len);
+    if (states == NULL)
+	return OK;
+    if (len > UF_SYNTAX_MAX_LEN
+	    || undo_write_bytes(bi, (long_u)UF_SYNTAX_MAGIC, 2) == FAIL
+	    || undo_write_bytes(bi, (long_u)len, 4) == FAIL
+	    || undo_write(bi, states, len) == FAIL)
+	retval = FAIL;
+    vim_free(states);
+    return retval;
+}
+
+/*
+ * Read the syntax states written by serialize_syntax(), if present.
+ * Problems are silently ignored, the states are not essential.
+ */
+    static void
+unserialize_syntax(bufinfo_T *bi)
+{
+    long	len;
+    char_u	*states;
+
+#  ifdef FEAT_CRYPT
+    if (bi->bi_state != NULL)
+	return;
+#  endif
+    if (undo_read_2c(bi) != UF_SYNTAX_MAGIC)
+	return;
+    len = undo_read_4c(bi);
+    if (len <= 0 || len > UF_SYNTAX_MAX_LEN)
+	return;
+    states = alloc(len);
+    if (states == NULL)
+	return;
+    if (undo_read(bi, states, (size_t)len) == FAIL)
+	vim_free(states);
+    else
+	syn_stack_set_cache(bi->bi_buf, states, (size_t)len);
+}
+# endif
+
 /*
  * Write the undo tree in an undo file.
  * When "name" is not NULL, use it as the name of the undo file.
@@ -1760,6 +1823,10 @@ u_write_undo(
 
     if (undo_write_bytes(&bi, (long_u)UF_HEADER_END_MAGIC, 2) == OK)
 	write_ok = TRUE;
+# ifdef FEAT_SYN_HL
+    if (write_ok && serialize_syntax(&bi) == FAIL)
+	write_ok = FALSE;
+# endif
 #ifdef U_DEBUG
     if (headers_written != buf->b_u_numhead)
     {
@@ -2144,6 +2211,10 @@ u_read_undo(char_u *name, char_u *hash, char_u *orig_name UNUSED)
     curbuf->b_u_synced = TRUE;
     vim_free(uhp_table);
 
+# ifdef FEAT_SYN_HL
+    unserialize_syntax(&bi);
+# endif
+
 #ifdef U_DEBUG
     for (i = 0; i < num_head; ++i)
 	if (uhp_table_used[i] == 0)
@@ -980,6 +980,7 @@ extern int (*dyn_libintl_wputenv)(const wchar_t *envstring);
 # define SST_FIX_STATES	 7	// size of sst_stack[].
 # define SST_DIST	 16	// normal distance between entries
 # define SST_INVALID	((synstate_T *)-1)	// invalid syn_state pointer
+# define SYN_IDLE_MSEC	 10L	// msec spent in one syntax_idle_parse() call
 
 # define HL_CONTAINED	0x01	// not used on toplevel
 # define HL_TRANSP	0x02	// has no highlighting
@@ -1193,6 +1194,7 @@ extern int (*dyn_libintl_wputenv)(const wchar_t *envstring);
 #define MFS_STOP	2	// stop syncing when a character is available
 #define MFS_FLUSH	4	// flushed file to disk
 #define MFS_ZERO	8	// only write block 0
+#define MFS_ASYNC	16	// write in the background when possible
 
 // flags for buf_copy_options()
 #define BCO_ENTER	1	// going to enter the buffer